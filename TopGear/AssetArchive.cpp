@@ -0,0 +1,189 @@
+#include "AssetArchive.h"
+#include "AssetLoader.h"
+#include "TextureAtlas.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+static const char archiveMagic[4] = { 'T', 'G', 'P', 'K' };
+static const std::uint64_t archiveAlignment = 16;
+
+bool AssetArchive::open(const std::string& filename)
+{
+    MappedFile mapped;
+    if (!mapped.open(filename)) {
+        std::cerr << "Failed to open asset archive: " << filename << std::endl;
+        return false;
+    }
+
+    AssetArchiveHeader header;
+    if (mapped.size < sizeof(header)) {
+        std::cerr << "Invalid asset archive: " << filename << std::endl;
+        return false;
+    }
+    std::memcpy(&header, mapped.data, sizeof(header));
+    if (std::memcmp(header.magic, archiveMagic, sizeof(archiveMagic)) != 0 || header.version != ASSET_ARCHIVE_VERSION) {
+        std::cerr << "Invalid asset archive or version: " << filename << std::endl;
+        return false;
+    }
+    if (header.count > (mapped.size - sizeof(header)) / sizeof(AssetArchiveEntry)) {
+        std::cerr << "Invalid asset count in " << filename << ": " << header.count << std::endl;
+        return false;
+    }
+
+    // Todas as entradas têm de caber no arquivo antes de alguém ler os dados
+    const AssetArchiveEntry* index = reinterpret_cast<const AssetArchiveEntry*>(mapped.data + sizeof(header));
+    for (std::uint32_t i = 0; i < header.count; i++) {
+        const AssetArchiveEntry& entry = index[i];
+        bool ok = std::memchr(entry.name, 0, sizeof(entry.name)) != nullptr
+            && entry.offset <= mapped.size && entry.size <= mapped.size - entry.offset;
+        if (entry.kind == AssetKind::Image) ok = ok && entry.size == static_cast<std::uint64_t>(entry.width) * entry.height * 4;
+        else if (entry.kind != AssetKind::Region && entry.kind != AssetKind::Blob) ok = false;
+        if (!ok) {
+            std::cerr << "Invalid asset entry " << i << " in " << filename << std::endl;
+            return false;
+        }
+    }
+
+    file = std::move(mapped);
+    entries = index;
+    count = header.count;
+    return true;
+}
+
+const AssetArchiveEntry* AssetArchive::find(const std::string& name) const
+{
+    for (std::uint32_t i = 0; i < count; i++) {
+        if (name == entries[i].name) return &entries[i];
+    }
+    return nullptr;
+}
+
+bool AssetArchive::check(const AssetManifest& manifest, const std::string& filename) const
+{
+    std::vector<std::string> missing;
+    auto expect = [&](const std::string& name, AssetKind kind) {
+        const AssetArchiveEntry* entry = find(name);
+        if (!entry || entry->kind != kind) missing.push_back(name);
+    };
+    for (const AtlasPage& page : manifest.atlases) {
+        expect(page.name, AssetKind::Image);
+        for (const std::string& name : page.images) expect(name, AssetKind::Region);
+    }
+    for (const std::string& name : manifest.images) expect(name, AssetKind::Image);
+    for (const auto& file : manifest.files) expect(file.first, AssetKind::Blob);
+
+    if (missing.empty()) return true;
+    std::cerr << "Missing " << missing.size() << " asset(s) in " << filename << ":";
+    for (const std::string& name : missing) std::cerr << " " << name;
+    std::cerr << std::endl;
+    return false;
+}
+
+static bool makeEntry(AssetArchiveEntry& entry, const std::string& name, AssetKind kind)
+{
+    std::memset(&entry, 0, sizeof(entry));
+    if (name.size() >= sizeof(entry.name)) {
+        std::cerr << "Asset name too long for the archive: " << name << std::endl;
+        return false;
+    }
+    std::memcpy(entry.name, name.c_str(), name.size());
+    entry.kind = kind;
+    return true;
+}
+
+bool packAssetArchive(const std::string& filename, const AssetManifest& manifest)
+{
+    // Decodifica tudo em paralelo, como no carregamento do jogo
+    AssetLoader loader;
+    std::vector<std::vector<size_t>> atlasJobs(manifest.atlases.size());
+    std::vector<size_t> imageJobs, fileJobs;
+    for (size_t p = 0; p < manifest.atlases.size(); p++) {
+        for (const std::string& name : manifest.atlases[p].images) atlasJobs[p].push_back(loader.addImage(name, "images/" + name + ".png"));
+    }
+    for (const std::string& name : manifest.images) imageJobs.push_back(loader.addImage(name, "images/" + name + ".png"));
+    for (const auto& file : manifest.files) fileJobs.push_back(loader.addFile(file.first, file.second));
+    loader.start();
+    if (!loader.wait()) return false;
+
+    std::vector<AssetArchiveEntry> index;
+    std::vector<const void*> data; // Source of each entry's bytes, nullptr for regions
+    auto add = [&](const std::string& name, AssetKind kind, const void* bytes, std::uint64_t size) -> AssetArchiveEntry* {
+        AssetArchiveEntry entry;
+        if (!makeEntry(entry, name, kind)) return nullptr;
+        entry.size = size;
+        index.push_back(entry);
+        data.push_back(bytes);
+        return &index.back();
+    };
+    auto addImage = [&](const std::string& name, const sf::Image& image) {
+        sf::Vector2u size = image.getSize();
+        AssetArchiveEntry* entry = add(name, AssetKind::Image, image.getPixelsPtr(), static_cast<std::uint64_t>(size.x) * size.y * 4);
+        if (!entry) return false;
+        entry->width = size.x;
+        entry->height = size.y;
+        return true;
+    };
+
+    std::vector<sf::Image> atlasImages(manifest.atlases.size()); // Written out at the end, so kept until then
+    for (size_t p = 0; p < manifest.atlases.size(); p++) {
+        const AtlasPage& page = manifest.atlases[p];
+        TextureAtlas atlas;
+        std::vector<const sf::Image*> images;
+        for (size_t job : atlasJobs[p]) images.push_back(&loader.image(job));
+        if (!atlas.pack(page.images, images, atlasImages[p]) || !addImage(page.name, atlasImages[p])) return false;
+        for (const std::string& name : page.images) {
+            AssetArchiveEntry* entry = add(name, AssetKind::Region, nullptr, 0);
+            if (!entry) return false;
+            sf::IntRect rect = atlas.get(name);
+            entry->left = rect.left;
+            entry->top = rect.top;
+            entry->width = static_cast<std::uint32_t>(rect.width);
+            entry->height = static_cast<std::uint32_t>(rect.height);
+        }
+    }
+    for (size_t i = 0; i < imageJobs.size(); i++) {
+        if (!addImage(manifest.images[i], loader.image(imageJobs[i]))) return false;
+    }
+    for (size_t i = 0; i < fileJobs.size(); i++) {
+        const std::vector<char>& bytes = loader.bytes(fileJobs[i]);
+        if (!add(manifest.files[i].first, AssetKind::Blob, bytes.data(), bytes.size())) return false;
+    }
+
+    // Dados alinhados a 16 bytes depois do índice
+    std::uint64_t offset = sizeof(AssetArchiveHeader) + index.size() * sizeof(AssetArchiveEntry);
+    for (AssetArchiveEntry& entry : index) {
+        offset = (offset + archiveAlignment - 1) / archiveAlignment * archiveAlignment;
+        entry.offset = offset;
+        offset += entry.size;
+    }
+
+    AssetArchiveHeader header;
+    std::memcpy(header.magic, archiveMagic, sizeof(archiveMagic));
+    header.version = ASSET_ARCHIVE_VERSION;
+    header.count = static_cast<std::uint32_t>(index.size());
+    header.reserved = 0;
+
+    FILE* f = std::fopen(filename.c_str(), "wb");
+    if (!f) {
+        std::cerr << "Failed to create asset archive: " << filename << std::endl;
+        return false;
+    }
+    bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1
+        && std::fwrite(index.data(), sizeof(AssetArchiveEntry), index.size(), f) == index.size();
+    std::uint64_t written = sizeof(header) + index.size() * sizeof(AssetArchiveEntry);
+    static const char zeros[archiveAlignment] = {};
+    for (size_t i = 0; i < index.size() && ok; i++) {
+        ok = std::fwrite(zeros, 1, static_cast<size_t>(index[i].offset - written), f) == index[i].offset - written;
+        if (ok && index[i].size > 0) ok = std::fwrite(data[i], 1, static_cast<size_t>(index[i].size), f) == index[i].size;
+        written = index[i].offset + index[i].size;
+    }
+    ok = std::fclose(f) == 0 && ok;
+    if (!ok) {
+        std::cerr << "Failed to write asset archive: " << filename << std::endl;
+        return false;
+    }
+    std::cout << "Packed " << index.size() << " assets into " << filename << " (" << written / 1024 << " KiB)" << std::endl;
+    return true;
+}
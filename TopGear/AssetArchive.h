@@ -0,0 +1,75 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#include <SFML/Graphics.hpp>
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Packed asset archive (.tgpak), little-endian: this header, then `count` index entries,
+// then the data of each entry at a 16-byte aligned offset. Images are stored as raw RGBA,
+// so the game creates textures straight from the mapped file without decoding anything.
+struct AssetArchiveHeader
+{
+    char magic[4]; // "TGPK"
+    std::uint32_t version;
+    std::uint32_t count;
+    std::uint32_t reserved;
+};
+
+enum class AssetKind : std::uint32_t
+{
+    Image,  // width x height RGBA pixels
+    Region, // Rect inside the image of its atlas page, no data of its own
+    Blob    // Raw file bytes (fonts)
+};
+
+struct AssetArchiveEntry
+{
+    char name[32]; // Zero-terminated
+    AssetKind kind;
+    std::uint32_t width, height;
+    std::int32_t left, top; // Region only
+    std::uint32_t reserved;
+    std::uint64_t offset, size; // Data bytes, relative to the start of the file
+};
+
+const std::uint32_t ASSET_ARCHIVE_VERSION = 2;
+
+// Images packed into one texture; smoothing is a property of the texture, so pixel art gets a page of its own
+struct AtlasPage
+{
+    std::string name; // Of the packed image
+    bool smooth;
+    std::vector<std::string> images; // images/<name>.png
+};
+
+// What the game loads, either as loose files or from an archive
+struct AssetManifest
+{
+    std::vector<AtlasPage> atlases;
+    std::vector<std::string> images;      // images/<name>.png, one texture each
+    std::vector<std::pair<std::string, std::string>> files; // Name and path of raw files
+};
+
+// Read-only view of a mapped archive; entries and data point into the mapping
+struct AssetArchive
+{
+    MappedFile file;
+    const AssetArchiveEntry* entries = nullptr;
+    std::uint32_t count = 0;
+
+    bool open(const std::string& filename);
+    const AssetArchiveEntry* find(const std::string& name) const;
+    const std::uint8_t* data(const AssetArchiveEntry& entry) const { return file.data + entry.offset; }
+
+    // Print every manifest entry the archive lacks, in one message; false if any is missing
+    bool check(const AssetManifest& manifest, const std::string& filename) const;
+};
+
+// Decode the loose files of the manifest and write them as an archive.
+// Needs a graphics context for the maximum texture size, as the atlas is laid out here.
+bool packAssetArchive(const std::string& filename, const AssetManifest& manifest);
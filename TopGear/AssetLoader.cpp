@@ -0,0 +1,98 @@
+#include "AssetLoader.h"
+#include "Log.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+AssetLoader::~AssetLoader()
+{
+    join();
+}
+
+size_t AssetLoader::addImage(const std::string& name, const std::string& filename)
+{
+    Job job;
+    job.name = name;
+    job.filename = filename;
+    job.isImage = true;
+    jobs.push_back(std::move(job));
+    return jobs.size() - 1;
+}
+
+size_t AssetLoader::addFile(const std::string& name, const std::string& filename)
+{
+    Job job;
+    job.name = name;
+    job.filename = filename;
+    jobs.push_back(std::move(job));
+    return jobs.size() - 1;
+}
+
+size_t AssetLoader::addTask(const std::string& name, std::function<bool()> task)
+{
+    Job job;
+    job.name = name;
+    job.task = std::move(task);
+    jobs.push_back(std::move(job));
+    return jobs.size() - 1;
+}
+
+void AssetLoader::start(unsigned threads)
+{
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<size_t>(threads, jobs.size()));
+    for (unsigned i = 0; i < threads; i++) workers.emplace_back(&AssetLoader::work, this);
+}
+
+static bool readFile(const std::string& filename, std::vector<char>& bytes)
+{
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file) return false;
+    std::streamoff size = file.tellg();
+    if (size < 0) return false;
+    bytes.resize(static_cast<size_t>(size));
+    file.seekg(0);
+    return size == 0 || static_cast<bool>(file.read(bytes.data(), size));
+}
+
+void AssetLoader::work()
+{
+    // Cada worker pega o próximo job livre até acabar a fila
+    for (;;) {
+        size_t i = next.fetch_add(1, std::memory_order_relaxed);
+        if (i >= jobs.size()) break;
+        Job& job = jobs[i];
+        long long start = profileNowNs();
+        if (job.task) job.ok = job.task();
+        else if (job.isImage) job.ok = job.image.loadFromFile(job.filename);
+        else job.ok = readFile(job.filename, job.bytes);
+        job.elapsedNs = profileNowNs() - start;
+        LOG_DEBUG(LogCategory::Assets, "Loaded %s in %.2f ms%s", job.name.c_str(), job.elapsedNs / 1e6, job.ok ? "" : " (failed)");
+        done.fetch_add(1, std::memory_order_release);
+    }
+}
+
+void AssetLoader::join()
+{
+    for (std::thread& worker : workers) {
+        if (worker.joinable()) worker.join();
+    }
+    workers.clear();
+}
+
+bool AssetLoader::wait()
+{
+    // Sem workers (start() não foi chamado) o trabalho é feito aqui mesmo
+    if (workers.empty()) work();
+    join();
+    bool ok = true;
+    for (const Job& job : jobs) {
+        if (job.ok) continue;
+        // Tasks print their own errors
+        if (!job.task) std::cerr << "Failed to load " << job.filename << std::endl;
+        ok = false;
+    }
+    return ok;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Loads assets on a pool of worker threads.
+// Workers only touch memory: images are decoded into sf::Image and other files are read
+// into byte buffers. Creating textures and fonts is left to the thread that owns the window.
+struct AssetLoader
+{
+    struct Job
+    {
+        std::string name;
+        std::string filename;
+        std::function<bool()> task; // Set for generic tasks (e.g. building the track)
+        sf::Image image;
+        std::vector<char> bytes;
+        bool isImage = false;
+        bool ok = false;
+        long long elapsedNs = 0;
+    };
+
+    AssetLoader() = default;
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+    ~AssetLoader();
+
+    // Queue work before start(); the returned index identifies the job
+    size_t addImage(const std::string& name, const std::string& filename);
+    size_t addFile(const std::string& name, const std::string& filename);
+    size_t addTask(const std::string& name, std::function<bool()> task);
+
+    // threads = 0 uses one worker per hardware thread (never more than the number of jobs)
+    void start(unsigned threads = 0);
+    size_t total() const { return jobs.size(); }
+    size_t finished() const { return done.load(std::memory_order_acquire); }
+    bool ready() const { return finished() == total(); }
+    // Blocks until every job ran; prints every one that failed and returns false if any did
+    bool wait();
+
+    const Job& job(size_t index) const { return jobs[index]; }
+    sf::Image& image(size_t index) { return jobs[index].image; }
+    const std::vector<char>& bytes(size_t index) const { return jobs[index].bytes; }
+
+private:
+    std::vector<Job> jobs;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> next{ 0 };
+    std::atomic<size_t> done{ 0 };
+
+    void work();
+    void join();
+};
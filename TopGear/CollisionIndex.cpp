@@ -0,0 +1,58 @@
+#include "CollisionIndex.h"
+
+#include <algorithm>
+
+void CollisionIndex::reset(const Track& track)
+{
+    const int n = track.size();
+    tag.assign(n, -1);
+    counts.assign(n, 0);
+    items.resize(static_cast<size_t>(n) * MAX_PER_SEGMENT);
+}
+
+bool CollisionIndex::fromSprite(const Track& track, int slot, Collidable& out)
+{
+    int id = track.sprite[slot];
+    const SpriteShape& shape = spriteShapes[id];
+    if (shape.kind == CollidableKind::None) return false;
+
+    // Mesma posição que drawSegmentSprite usa na tela, em meias larguras de pista
+    float spriteX = track.spriteX[slot];
+    float imageWidth = shape.imageWidth / 266.0f;
+    float origin = spriteX / roadW + spriteX * imageWidth;
+    out.left = origin + shape.footLeft * imageWidth;
+    out.right = origin + shape.footRight * imageWidth;
+    out.kind = shape.kind;
+    out.sprite = static_cast<unsigned char>(id);
+    return true;
+}
+
+void CollisionIndex::fill(const Track& track, int slot, long long segment)
+{
+    Collidable* list = &items[static_cast<size_t>(slot) * MAX_PER_SEGMENT];
+    int count = 0;
+
+    if (fromSprite(track, slot, list[count])) count++;
+
+    std::sort(list, list + count, [](const Collidable& a, const Collidable& b) { return a.left < b.left; });
+    counts[slot] = static_cast<unsigned char>(count);
+    tag[slot] = segment;
+}
+
+void CollisionIndex::sweep(const Track& track, long long from, long long to, float left, float right, std::vector<CollisionHit>& hits)
+{
+    const int n = track.size();
+    // Mais de uma volta num tick não acontece; basta olhar cada segmento uma vez
+    if (to - from > n) from = to - n;
+    for (long long segment = from + 1; segment <= to; segment++) {
+        int slot = static_cast<int>(((segment % n) + n) % n);
+        // A looping track never changes; a streamed ring slot changes with the segment it holds
+        long long key = track.isStreamed() ? segment : slot;
+        if (tag[slot] != key) fill(track, slot, key);
+
+        const Collidable* list = &items[static_cast<size_t>(slot) * MAX_PER_SEGMENT];
+        for (int k = 0; k < counts[slot] && list[k].left <= right; k++) {
+            if (list[k].right >= left) hits.push_back({ segment, list[k] });
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Track.h"
+
+#include <vector>
+
+// Things on a segment a car can touch, with their extent across the road
+// (in road half-widths, like the car's x: the road edges are at -1 and 1)
+enum class CollidableKind : unsigned char { None, Pickup, Obstacle };
+
+struct Collidable
+{
+    float left, right;
+    CollidableKind kind;
+    unsigned char sprite;
+};
+
+// Collision footprint of each scenery sprite: the image width in pixels (sprites are drawn
+// width / 266 road half-widths wide) and the part of it that touches the ground, as fractions of the width
+struct SpriteShape
+{
+    CollidableKind kind;
+    float imageWidth;
+    float footLeft, footRight;
+};
+
+const SpriteShape spriteShapes[SPRITE_GAS + 1] = {
+    { CollidableKind::None, 0.0f, 0.0f, 0.0f },
+    { CollidableKind::Obstacle, 747.0f, 0.42f, 0.53f }, // Palm, trunk
+    { CollidableKind::Obstacle, 726.0f, 0.40f, 0.55f },
+    { CollidableKind::Obstacle, 1024.0f, 0.10f, 0.90f },
+    { CollidableKind::Obstacle, 785.0f, 0.12f, 0.30f }, // Bent palm, trunk
+    { CollidableKind::Obstacle, 500.0f, 0.38f, 0.56f }, // Tree, trunk
+    { CollidableKind::None, 650.0f, 0.0f, 0.0f }, // Grass
+    { CollidableKind::Pickup, 1024.0f, 0.0f, 1.0f }, // Fuel station, all of it
+};
+
+struct CollisionHit
+{
+    long long segment; // Distance along the race, as Track::distance
+    Collidable item;
+};
+
+// Collidables per segment, sorted by left edge, so a car only looks at the segments it crossed.
+// Lists are built from the track's sprite table the first time a segment is swept and kept while
+// the segment is unchanged; on a streamed track a ring slot is rebuilt once it holds a new segment.
+struct CollisionIndex
+{
+    static const int MAX_PER_SEGMENT = 2;
+
+    void reset(const Track& track);
+
+    // Collidable of a segment's scenery sprite; false if the sprite is not solid
+    static bool fromSprite(const Track& track, int slot, Collidable& out);
+
+    // Append every collidable on the segments after `from` up to and including `to` whose extent
+    // overlaps [left, right], nearest segment first. The cost is the number of segments crossed.
+    void sweep(const Track& track, long long from, long long to, float left, float right, std::vector<CollisionHit>& hits);
+
+private:
+    std::vector<long long> tag; // Segment whose list each slot holds, -1 if none
+    std::vector<unsigned char> counts;
+    std::vector<Collidable> items; // MAX_PER_SEGMENT per slot
+
+    void fill(const Track& track, int slot, long long segment);
+};
@@ -0,0 +1,43 @@
+#include "Culling.h"
+#include "GameConstants.h"
+
+#include <algorithm>
+
+ScreenBox sceneryBox(const Track& track, const ProjectedTrack& proj, int i, float w, float h)
+{
+    float spriteX = track.spriteX[i];
+    float W = proj.W[i];
+    ScreenBox box;
+    box.w = w * W / 266.0f;
+    box.h = h * W / 266.0f;
+    box.x = proj.X[i] + proj.scale[i] * spriteX * width / 2.0f + box.w * spriteX; // offsetX
+    box.y = proj.Y[i] + 4.0f - box.h; // offsetY
+    return box;
+}
+
+ScreenBox opponentBox(const Track& track, const CarPose& pose, float relativeZ, float w, float h, int playerPos, int cameraX, int cameraY)
+{
+    // Usar projeção semelhante à projectSegment, com a pista no ponto exato do adversário
+    int startPos = playerPos / segL;
+    double opponentSegment = static_cast<double>(playerPos + relativeZ) / segL;
+    TrackPoint road = track.pointFrom(startPos, opponentSegment);
+    float scale = camD / static_cast<float>((opponentSegment - startPos) * segL);
+
+    float baseScale = desiredCarHeight / h; // Mesma altura base do jogador
+    float distanceScale = std::max(0.1f, (1.0f / relativeZ) * 2400.0f);
+    float finalScale = std::max(0.1f, std::min(baseScale * distanceScale, 5.0f)); // Limitar escala - 1
+
+    ScreenBox box;
+    box.w = w * finalScale;
+    box.h = h * finalScale;
+    box.x = (1.0f - scale * (cameraX - road.x)) * width / 2.0f + scale * pose.x * width / 2.0f + box.w * pose.x;
+    box.y = (1.0f - scale * (road.y - cameraY)) * height / 2.0f + 4.0f - box.h; // Alinhar com a pista
+    return box;
+}
+
+CullReason cullBox(const ScreenBox& box, float clip)
+{
+    if (box.x + box.w <= 0.0f || box.x >= width || box.y + box.h <= 0.0f) return CullReason::OffScreen;
+    if (box.y >= std::min(clip, static_cast<float>(height))) return CullReason::Hidden;
+    return CullReason::Visible;
+}
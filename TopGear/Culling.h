@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Projection.h"
+#include "Simulation.h"
+#include "Track.h"
+
+#include <vector>
+
+// Screen rectangle of a sprite before it is clipped by the hills
+struct ScreenBox
+{
+    float x, y, w, h;
+};
+
+// Pixel size of the images of the sprite pass, so the simulation stage can place and cull them without the atlas
+struct SpriteSizes
+{
+    float sceneryW[SPRITE_GAS + 1] = {}, sceneryH[SPRITE_GAS + 1] = {};
+    std::vector<float> carW, carH; // Opponent i uses entry i % size, like the car colours
+};
+
+// Where the scenery sprite of segment i goes, for an image w by h pixels
+ScreenBox sceneryBox(const Track& track, const ProjectedTrack& proj, int i, float w, float h);
+
+// Where an opponent relativeZ ahead of the camera goes, on the road at its exact track position.
+// The camera stands on the segment of playerPos like the road projection, at lateral cameraX and height cameraY.
+ScreenBox opponentBox(const Track& track, const CarPose& pose, float relativeZ, float w, float h, int playerPos, int cameraX, int cameraY);
+
+enum class CullReason { Visible, Hidden, OffScreen };
+
+// Hidden: no row above clip, the top of the hills in front, or above the bottom of the screen.
+// OffScreen: wholly left, right or above the screen.
+CullReason cullBox(const ScreenBox& box, float clip);
+
+// What the snapshot build left out of a frame, and why
+struct CullStats
+{
+    int roadHidden = 0; // Window segments behind a crest
+    int roadOffScreen = 0; // Segments whose road and rumble are beside the screen; only the grass band is drawn
+    int roadDrawn = 0; // Spans of road, after far segments are merged
+    int spritesHidden = 0, spritesOffScreen = 0, spritesDrawn = 0;
+    int carsHidden = 0, carsOffScreen = 0, carsDrawn = 0;
+};
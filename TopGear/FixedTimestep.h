@@ -0,0 +1,31 @@
+#pragma once
+
+// Turns variable frame times into a whole number of fixed simulation ticks.
+// The leftover time is kept for the next frame and used to interpolate drawing.
+struct FixedTimestep
+{
+    float tickSeconds;
+    float accumulator = 0.0f;
+    int maxTicksPerFrame = 8; // After a long hitch the extra time is dropped instead of catching up
+
+    explicit FixedTimestep(float rateHz)
+        : tickSeconds(1.0f / rateHz)
+    {
+    }
+
+    // Number of ticks to run for a frame that took frameSeconds
+    int advance(float frameSeconds)
+    {
+        accumulator += frameSeconds;
+        int ticks = 0;
+        while (accumulator >= tickSeconds && ticks < maxTicksPerFrame) {
+            accumulator -= tickSeconds;
+            ticks++;
+        }
+        if (ticks == maxTicksPerFrame && accumulator >= tickSeconds) accumulator = 0.0f;
+        return ticks;
+    }
+
+    // How far the frame is between the last two ticks (0..1)
+    float alpha() const { return accumulator / tickSeconds; }
+};
@@ -0,0 +1,372 @@
+#include "FramePipeline.h"
+#include "GameConstants.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+const int H = 900; // Altura da câmara acima da pista
+const float minCarDepth = 10.0f, maxCarDepth = 100.0f * segL; // Opponents drawn between these distances ahead
+const int bandSegments = 3; // Segments per colour band of the road
+const int maxMergedSegments = 64 * 2 * bandSegments;
+
+// Spin briefly, then yield, then sleep: a short wait stays fast and a long one leaves the core alone
+template <typename Ready>
+static void waitUntil(Ready ready)
+{
+    for (int spins = 0; !ready(); spins++) {
+        if (spins < 1000) std::this_thread::yield();
+        else std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+}
+
+FramePipeline::FramePipeline(Simulation& s, FixedTimestep& ts, InputRecording& rec, bool replay, bool record, bool benchmark, bool threaded)
+    : sim(s), timestep(ts), recording(rec), replaying(replay), recordInputs(record), bench(benchmark)
+{
+    for (FrameSnapshot& b : buffers) b.proj.resize(sim.track.size());
+    setDrawSettings(DrawSettings());
+    captureRenderState(sim, currState);
+    prevState = currState;
+
+    if (threaded) worker = std::thread(&FramePipeline::run, this);
+}
+
+void FramePipeline::setDrawSettings(const DrawSettings& s)
+{
+    settings = s;
+    visibleSegments.reserve(settings.drawDistance);
+    roadOnScreen.reserve(settings.drawDistance);
+    carBucket.resize(settings.drawDistance + 1);
+}
+
+FramePipeline::~FramePipeline()
+{
+    stop();
+}
+
+void FramePipeline::request(const FrameRequest& r)
+{
+    pending = r;
+    unsigned frame = requested.load(std::memory_order_relaxed) + 1;
+    if (!worker.joinable()) {
+        build(pending, buffers[frame % 2]);
+        published.store(frame, std::memory_order_relaxed);
+    }
+    requested.store(frame, std::memory_order_release);
+}
+
+const FrameSnapshot& FramePipeline::wait()
+{
+    unsigned frame = requested.load(std::memory_order_relaxed);
+    waitUntil([&] { return published.load(std::memory_order_acquire) == frame; });
+    return buffers[frame % 2];
+}
+
+void FramePipeline::stop()
+{
+    if (!worker.joinable()) return;
+    wait();
+    quit.store(true, std::memory_order_release);
+    worker.join();
+}
+
+void FramePipeline::run()
+{
+    unsigned done = 0;
+    while (true) {
+        waitUntil([&] { return requested.load(std::memory_order_acquire) != done || quit.load(std::memory_order_acquire); });
+        if (requested.load(std::memory_order_acquire) == done) return; // quit with nothing pending
+
+        done++;
+        build(pending, buffers[done % 2]);
+        published.store(done, std::memory_order_release);
+    }
+}
+
+// Far away a colour band (3 segments) is a pixel or two tall, and a quad per visible segment only adds
+// vertices that shimmer between light and dark as the camera moves. Aligned runs of whole light-dark
+// pairs (6, 12, 24 ... segments, counted from the start of the track so a run keeps the same segments
+// from frame to frame) become one span once their visible segments are shorter than lodPixels on screen. The span takes
+// the average colour of all its segments, which is the same for every run length.
+void FramePipeline::mergeFarSegments(FrameSnapshot& out)
+{
+    const ProjectedTrack& proj = out.proj;
+    const int n = sim.track.size();
+    const int count = static_cast<int>(visibleSegments.size());
+    out.roadSpans.clear();
+
+    for (int v = 0; v < count;) {
+        int segment = visibleSegments[v];
+        float bottom = proj.Y[(segment - 1 + n) % n]; // The line the quads of the segment start at
+        RoadSpan span = { segment - 1, segment, segment, 1, false };
+        int used = 1; // Visible segments in the span
+        for (int run = 2 * bandSegments; run <= maxMergedSegments && settings.lodPixels > 0.0f; run *= 2) {
+            // The run holding this segment, if no nearer span drew part of it. Runs are aligned on the
+            // track index, so they keep their segments as the window crosses the end of the ring, and
+            // the last run of a lap is cut short there.
+            int lapStart = segment - segment % n;
+            int first = lapStart + segment % n - segment % n % run;
+            int end = std::min(first + run, lapStart + n);
+            if (v > 0 && visibleSegments[v - 1] >= first) break;
+            int w = v;
+            while (w < count && visibleSegments[w] < end) w++;
+            if (bottom - proj.Y[visibleSegments[w - 1] % n] >= settings.lodPixels) break;
+            span.farLine = visibleSegments[w - 1];
+            span.first = first;
+            span.count = end - first;
+            used = w - v;
+        }
+
+        for (int j = v; j < v + used; j++) span.roadOnScreen = span.roadOnScreen || roadOnScreen[j];
+        out.roadSpans.push_back(span);
+        v += used;
+    }
+    out.cull.roadDrawn = static_cast<int>(out.roadSpans.size());
+
+    out.finishLines.clear();
+    if (out.roadSpans.empty()) return;
+    const RoadSpan& last = out.roadSpans.back();
+    out.finishFirst = out.roadSpans.front().first;
+    for (int k = out.finishFirst; k < last.first + last.count; k++) out.finishLines.push_back(sim.track.isFinishLine[k % n]);
+}
+
+// Counting sort of the opponents by window segment: one pass to count, one to place, so it stays
+// linear however many cars there are. Cars sharing a segment are then put far to near.
+// The depth of a car is its race distance from the camera. On a looping track cars whole laps apart share
+// the road; on a streamed one the ring holds only the window, so a car a ring length away is elsewhere.
+void FramePipeline::bucketCars(const FrameSnapshot& frame, float trackLength)
+{
+    const int count = static_cast<int>(frame.cars.opponents.size());
+    const std::vector<unsigned char>& finished = frame.opponentFinished;
+    const bool looping = !sim.track.isStreamed();
+    const double camera = static_cast<double>(frame.cars.player.wraps) * trackLength + frame.pos % static_cast<int>(trackLength);
+    const float cameraInSegment = static_cast<float>(frame.pos % segL);
+    const int drawDistance = settings.drawDistance;
+    std::vector<int>& bucket = carBucket;
+    carDepth.resize(count);
+    std::fill(bucket.begin(), bucket.end(), 0);
+
+    for (int i = 0; i < count; i++) {
+        const CarPose& car = frame.cars.opponents[i];
+        double gap = static_cast<double>(car.wraps) * trackLength + car.pos - camera;
+        if (looping) gap -= std::floor(gap / trackLength) * trackLength;
+        float depth = static_cast<float>(gap);
+        carDepth[i] = depth;
+        if (finished[i] || depth < minCarDepth || depth > maxCarDepth) continue;
+        bucket[static_cast<int>((cameraInSegment + depth) / segL) + 1]++;
+    }
+    for (int k = 0; k < drawDistance; k++) bucket[k + 1] += bucket[k];
+
+    carOrder.resize(bucket[drawDistance]);
+    for (int i = 0; i < count; i++) {
+        float depth = carDepth[i];
+        if (finished[i] || depth < minCarDepth || depth > maxCarDepth) continue;
+        int k = static_cast<int>((cameraInSegment + depth) / segL);
+        // bucket[k] is the next free place of segment k until the pass ends, then the start of segment k + 1
+        carOrder[bucket[k]++] = i;
+    }
+    for (int k = drawDistance; k > 0; k--) bucket[k] = bucket[k - 1];
+    bucket[0] = 0;
+
+    for (int k = 0; k < drawDistance; k++) {
+        for (int a = bucket[k] + 1; a < bucket[k + 1]; a++) {
+            int car = carOrder[a];
+            int b = a;
+            for (; b > bucket[k] && carDepth[carOrder[b - 1]] < carDepth[car]; b--) carOrder[b] = carOrder[b - 1];
+            carOrder[b] = car;
+        }
+    }
+}
+
+// Place every car and scenery sprite of the window back to front, keeping only the ones with a row
+// on screen above the hills in front of them. The cars of a segment go between the scenery of the
+// next line and its own.
+void FramePipeline::cullSprites(FrameSnapshot& out)
+{
+    const Track& track = sim.track;
+    const ProjectedTrack& proj = out.proj;
+    const int n = track.size();
+    const int drawDistance = settings.drawDistance;
+    CullStats& cull = out.cull;
+    out.sprites.clear();
+
+    auto keep = [&](const SpriteDraw& d, int& hidden, int& offScreen, int& drawn) {
+        switch (cullBox(d.box, d.clip)) {
+        case CullReason::Hidden: hidden++; break;
+        case CullReason::OffScreen: offScreen++; break;
+        default: drawn++; out.sprites.push_back(d); break;
+        }
+    };
+
+    for (int k = drawDistance - 1; k >= 0; k--) {
+        int i = (out.startPos + k) % n;
+        for (int c = carBucket[k]; c < carBucket[k + 1]; c++) {
+            int car = carOrder[c];
+            size_t size = car % spriteSizes.carW.size();
+            SpriteDraw d;
+            d.box = opponentBox(track, out.cars.opponents[car], carDepth[car], spriteSizes.carW[size], spriteSizes.carH[size],
+                out.pos, static_cast<int>(out.camX), out.camH);
+            d.clip = std::min(proj.clip[i], proj.Y[i]); // Below the crest of line k or of any nearer one
+            d.car = car;
+            d.image = 0;
+            keep(d, cull.carsHidden, cull.carsOffScreen, cull.carsDrawn);
+        }
+        int sprite = track.sprite[i];
+        if (k > 0 && sprite != SPRITE_NONE) {
+            SpriteDraw d;
+            d.box = sceneryBox(track, proj, i, spriteSizes.sceneryW[sprite], spriteSizes.sceneryH[sprite]);
+            d.clip = proj.clip[i];
+            d.car = -1;
+            d.image = sprite;
+            keep(d, cull.spritesHidden, cull.spritesOffScreen, cull.spritesDrawn);
+        }
+    }
+    groupByPage(out);
+}
+
+static bool overlap(const ScreenBox& a, const ScreenBox& b)
+{
+    return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+}
+
+// The scenery and the cars are on two atlas pages, and the sprite pass draws one call per run of sprites
+// from the same page. A sprite only has to come after the sprites drawn before it that it overlaps, so
+// each one joins the earliest run of its page after the last run it overlaps, and starts a new run if
+// there is none. The boxes are the unclipped ones, a little larger than what is drawn.
+void FramePipeline::groupByPage(FrameSnapshot& out)
+{
+    std::vector<SpriteDraw>& sprites = out.sprites;
+    const int count = static_cast<int>(sprites.size());
+    runCars.clear();
+    runBounds.clear();
+    runFirst.clear();
+    runLast.clear();
+    nextInRun.assign(count, -1);
+    out.depthOrderCalls = 0;
+
+    for (int s = 0; s < count; s++) {
+        const SpriteDraw& d = sprites[s];
+        const bool car = d.car >= 0;
+        if (s == 0 || car != (sprites[s - 1].car >= 0)) out.depthOrderCalls++;
+
+        int join = -1;
+        for (int r = static_cast<int>(runCars.size()) - 1; r >= 0; r--) {
+            bool covered = false;
+            if (overlap(runBounds[r], d.box)) {
+                for (int o = runFirst[r]; o >= 0 && !covered; o = nextInRun[o]) covered = overlap(sprites[o].box, d.box);
+            }
+            if ((runCars[r] != 0) == car) join = r;
+            if (covered) break;
+        }
+        if (join < 0) {
+            join = static_cast<int>(runCars.size());
+            runCars.push_back(car ? 1 : 0);
+            runBounds.push_back(d.box);
+            runFirst.push_back(s);
+            runLast.push_back(s);
+            continue;
+        }
+        ScreenBox& b = runBounds[join];
+        float right = std::max(b.x + b.w, d.box.x + d.box.w), bottom = std::max(b.y + b.h, d.box.y + d.box.h);
+        b.x = std::min(b.x, d.box.x);
+        b.y = std::min(b.y, d.box.y);
+        b.w = right - b.x;
+        b.h = bottom - b.y;
+        nextInRun[runLast[join]] = s;
+        runLast[join] = s;
+    }
+
+    if (count == 0 || sprites[count - 1].car < 0) out.depthOrderCalls++; // The player's car comes last, from the car page
+
+    grouped.clear();
+    for (int first : runFirst) {
+        for (int o = first; o >= 0; o = nextInRun[o]) grouped.push_back(sprites[o]);
+    }
+    sprites.swap(grouped);
+}
+
+void FramePipeline::build(const FrameRequest& r, FrameSnapshot& out)
+{
+    out.buildStartNs = profileNowNs();
+    const Track& track = sim.track;
+    const int n = track.size();
+
+    // Edges of frames that ran no tick are kept for the next tick
+    edges.pressed |= r.input.pressed;
+    edges.released |= r.input.released;
+
+    int ticks = bench ? 1 : timestep.advance(r.elapsedSeconds);
+    for (int i = 0; i < ticks && !sim.isRaceOver(); i++) {
+        if (replaying && tick >= recording.ticks.size()) break;
+        InputSnapshot tickInput = r.input;
+        tickInput.pressed = edges.pressed;
+        tickInput.released = edges.released;
+        edges.pressed = edges.released = 0;
+        if (replaying) tickInput = recording.get(tick);
+        if (recordInputs) recording.add(tickInput);
+        std::swap(prevState, currState);
+        sim.step(tickInput, timestep.tickSeconds);
+        captureRenderState(sim, currState);
+        tick++;
+    }
+    interpolateRenderState(prevState, currState, bench ? 1.0f : timestep.alpha(), static_cast<float>(n * segL), out.cars);
+
+    const Player& player = sim.player;
+    out.opponentFinished.assign(sim.opponents.finished.begin(), sim.opponents.finished.end());
+    out.playerSteer = player.steer;
+    out.playerPosition = sim.playerPosition;
+    out.speed = player.speed;
+    out.gas = player.gas;
+    out.laps = track.lapsDone(player.laps, player.pos / segL);
+    out.gear = player.gear;
+    out.onGrass = player.onGrass;
+    out.raceOver = sim.isRaceOver();
+    out.replayEnded = replaying && tick >= recording.ticks.size() && !out.raceOver;
+    out.tick = tick;
+
+    out.pos = static_cast<int>(out.cars.player.pos);
+    out.startPos = out.pos / segL;
+    out.camX = out.cars.player.x * roadW;
+    out.camH = static_cast<int>(track.y[out.startPos] + H);
+
+    // Projetar a pista e guardar os segmentos que ficam visíveis acima dos anteriores.
+    // clip is the horizon of each line: the top of the road nearer to the camera, which hides what is below it.
+    out.cull = CullStats();
+    {
+        PROFILE_SCOPE(ProfilePhase::Projection);
+        ProjectedTrack& proj = out.proj;
+        projectWindow(track, proj, out.startPos, settings.drawDistance, out.camX, static_cast<float>(out.camH));
+
+        int maxy = height;
+        visibleSegments.clear();
+        roadOnScreen.clear();
+        for (int k = out.startPos; k < out.startPos + settings.drawDistance; k++) {
+            int i = k % n;
+            proj.clip[i] = static_cast<float>(maxy);
+            if (proj.Y[i] >= maxy) {
+                out.cull.roadHidden++;
+                continue;
+            }
+            maxy = static_cast<int>(proj.Y[i]);
+            visibleSegments.push_back(k);
+
+            // Rumble and road of a sharp curve can be wholly beside the screen; the grass band never is
+            int p = (k - 1 + n) % n;
+            float left = std::min(proj.X[p] - proj.W[p] * 1.2f, proj.X[i] - proj.W[i] * 1.2f);
+            float right = std::max(proj.X[p] + proj.W[p] * 1.2f, proj.X[i] + proj.W[i] * 1.2f);
+            bool onScreen = right > -1.0f && left < width + 1.0f;
+            roadOnScreen.push_back(onScreen);
+            if (!onScreen) out.cull.roadOffScreen++;
+        }
+        mergeFarSegments(out);
+    }
+
+    {
+        PROFILE_SCOPE(ProfilePhase::Culling);
+        bucketCars(out, static_cast<float>(n * segL));
+        cullSprites(out);
+    }
+
+    out.buildEndNs = profileNowNs();
+}
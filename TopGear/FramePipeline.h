@@ -0,0 +1,151 @@
+#pragma once
+
+#include "Culling.h"
+#include "FixedTimestep.h"
+#include "Projection.h"
+#include "Replay.h"
+#include "Simulation.h"
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// How far and how finely the road is drawn
+struct DrawSettings
+{
+    int drawDistance = DRAW_DISTANCE; // Segments; at most one less than a looping track
+    float lodPixels = 2.0f; // Far runs of segments shorter than this on screen become one quad per stripe; 0 = off
+};
+
+// Input of the simulation stage for one frame
+struct FrameRequest
+{
+    float elapsedSeconds = 0.0f; // Wall time of the frame that sent it
+    InputSnapshot input; // Held now, edges since the previous request
+};
+
+// Road drawn as one quad per stripe: from line nearLine up to line farLine, in the colours of segments first to
+// first + count - 1. A single segment has nearLine = first - 1, farLine = first and count = 1. All unwrapped past the
+// end of the ring, like the colour banding.
+struct RoadSpan
+{
+    int nearLine, farLine;
+    int first, count;
+    bool roadOnScreen; // false if only the grass band reaches the screen
+};
+
+// A sprite of the depth-ordered pass: an opponent car, or the scenery sprite of a track segment
+struct SpriteDraw
+{
+    ScreenBox box;
+    float clip; // Rows from here down are behind the hills in front
+    int car; // Opponent index, -1 for scenery
+    int image; // Sprite id of the scenery
+};
+
+// Everything the render stage needs for one frame, built by the simulation stage.
+// Read-only once published.
+struct FrameSnapshot
+{
+    RenderState cars; // Interpolated car poses and sky offset
+    std::vector<unsigned char> opponentFinished;
+    int playerSteer = 0;
+
+    // HUD
+    int playerPosition = 1;
+    float speed = 0.0f;
+    float gas = 0.0f;
+    int laps = 0;
+    int gear = 1;
+    bool onGrass = false;
+
+    // Camera and the road seen from it
+    int pos = 0; // Position along the track
+    int startPos = 0; // Segment under the camera
+    float camX = 0.0f; // Lateral position
+    int camH = 0; // Height
+    ProjectedTrack proj;
+    std::vector<RoadSpan> roadSpans; // Near to far
+    // Finish-line flags of the segments of roadSpans, from finishFirst on. The draw reads these and not the
+    // track: a streamed track that rewinds rewrites its ring while the previous frame is drawn.
+    std::vector<unsigned char> finishLines;
+    int finishFirst = 0;
+    bool isFinishLine(int segment) const { return finishLines[segment - finishFirst] != 0; }
+
+    // Scenery and opponents that survived culling, placed on screen but not yet clipped. Far to near, except
+    // that sprites of one atlas page move next to each other past sprites of the other page they do not overlap.
+    std::vector<SpriteDraw> sprites;
+    int depthOrderCalls = 0; // Draw calls the sprites and the player's car would take in plain far-to-near order, for the F3 table
+    CullStats cull;
+
+    bool raceOver = false;
+    bool replayEnded = false; // A replay ran out of ticks before the race finished
+    size_t tick = 0; // Ticks simulated so far
+
+    long long buildStartNs = 0, buildEndNs = 0; // When the simulation stage worked on it
+};
+
+// Two-stage frame: a worker thread advances the simulation and builds the snapshot of frame N + 1
+// while the main thread draws frame N. The snapshots are a double buffer handed over with two
+// counters, so neither side takes a lock; with threaded = false both stages run on the calling thread.
+struct FramePipeline
+{
+    FramePipeline(Simulation& sim, FixedTimestep& timestep, InputRecording& recording, bool replaying, bool recordInputs, bool bench, bool threaded);
+    ~FramePipeline();
+    FramePipeline(const FramePipeline&) = delete;
+    FramePipeline& operator=(const FramePipeline&) = delete;
+
+    // Image sizes used to place and cull the sprites, and the draw settings; set before the first request
+    void setSpriteSizes(const SpriteSizes& sizes) { spriteSizes = sizes; }
+    void setDrawSettings(const DrawSettings& settings);
+
+    // Start building the next snapshot
+    void request(const FrameRequest& r);
+    // Wait for the snapshot of the last request; it stays valid until the request after the next
+    const FrameSnapshot& wait();
+    // Finish the pending snapshot and stop the worker
+    void stop();
+
+    size_t ticks() const { return tick; } // After stop()
+
+private:
+    Simulation& sim;
+    FixedTimestep& timestep;
+    InputRecording& recording;
+    bool replaying, recordInputs, bench;
+
+    RenderState prevState, currState;
+    size_t tick = 0;
+    InputSnapshot edges; // Presses and releases not yet seen by a tick
+    SpriteSizes spriteSizes;
+    DrawSettings settings;
+    std::vector<int> visibleSegments; // Near to far, unwrapped past the end of the ring
+    std::vector<unsigned char> roadOnScreen; // Per visible segment
+
+    // Opponents in sight by the segment of the draw window they are on: the cars k segments ahead of the
+    // camera are carOrder[carBucket[k]] up to carOrder[carBucket[k + 1] - 1], far to near
+    std::vector<int> carBucket; // settings.drawDistance + 1 offsets
+    std::vector<int> carOrder;
+    std::vector<float> carDepth; // Distance of each opponent ahead of the camera
+
+    // Runs of sprites from one page while grouping: the page (1 for cars), the box around the run's sprites,
+    // and its sprites as a list (first of each run, next of each sprite, -1 at the end)
+    std::vector<unsigned char> runCars;
+    std::vector<ScreenBox> runBounds;
+    std::vector<int> runFirst, runLast, nextInRun;
+    std::vector<SpriteDraw> grouped;
+
+    FrameSnapshot buffers[2];
+    FrameRequest pending;
+    std::atomic<unsigned> requested{ 0 }, published{ 0 }; // Frames handed over in each direction
+    std::atomic<bool> quit{ false };
+    std::thread worker;
+
+    void run();
+    void build(const FrameRequest& r, FrameSnapshot& out);
+    void mergeFarSegments(FrameSnapshot& out);
+    void bucketCars(const FrameSnapshot& frame, float trackLength);
+    void cullSprites(FrameSnapshot& out);
+    void groupByPage(FrameSnapshot& out);
+};
@@ -0,0 +1,14 @@
+#pragma once
+
+// Game constants
+const int width = 1024;
+const int height = 768;
+const int roadW = 2000;
+const int segL = 200; // segment length
+const float camD = 0.84f; // camera depth
+const int N_LINES = 1600;
+const int DRAW_DISTANCE = 300; // Segments drawn ahead of the camera, by default
+const int MAX_DRAW_DISTANCE = 2000; // With --draw-distance, for faster machines
+const int TOTAL_LAPS = 8; // Race ends after 8 laps
+const float desiredCarHeight = 150.0f; // Moved to global scope for consistency; was 150
+const float SIM_RATE = 120.0f; // Default simulation ticks per second
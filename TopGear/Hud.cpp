@@ -0,0 +1,203 @@
+#include "Hud.h"
+#include "GameConstants.h"
+
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+using namespace sf;
+
+enum HudFieldId { FieldLaps, FieldVelocity, FieldGear, FieldPosition, FieldGas, FieldGrass };
+
+const float outlineThickness = 2.0f;
+
+// Append text or a decimal number to a fixed buffer; returns the new end
+static char* appendText(char* out, const char* text)
+{
+    while (*text) *out++ = *text++;
+    return out;
+}
+
+static char* appendInt(char* out, int value)
+{
+    char digits[12];
+    int count = 0;
+    unsigned magnitude = value < 0 ? 0u - static_cast<unsigned>(value) : static_cast<unsigned>(value);
+    do {
+        digits[count++] = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0) *out++ = '-';
+    while (count > 0) *out++ = digits[--count];
+    return out;
+}
+
+Hud::Hud(const Font& f)
+    : font(f)
+{
+    // Bake every printable character once, with and without the outline, into the font texture
+    for (int c = 32; c < 127; c++) {
+        const Glyph& g = font.getGlyph(c, characterSize, false);
+        fill[c].bounds = g.bounds;
+        fill[c].rect = g.textureRect;
+        fill[c].advance = g.advance;
+        const Glyph& o = font.getGlyph(c, characterSize, false, outlineThickness);
+        outline[c].bounds = o.bounds;
+        outline[c].rect = o.textureRect;
+        outline[c].advance = o.advance;
+    }
+
+    const Vector2f positions[fieldCount] = { { 20.0f, 60.0f }, { 20.0f, 100.0f }, { 20.0f, 140.0f }, { 20.0f, 180.0f }, { 20.0f, 300.0f }, { 20.0f, 340.0f } };
+    const Color colors[fieldCount] = { Color::White, Color::White, Color::Yellow, Color::Cyan, Color::White, Color::Red };
+    for (int i = 0; i < fieldCount; i++) {
+        fields[i].position = positions[i];
+        fields[i].color = colors[i];
+        fields[i].value = INT_MIN;
+        fields[i].vertices.reserve(maxFieldChars * 12);
+    }
+    batch.reserve(fieldCount * maxFieldChars * 12);
+}
+
+// Same quads as sf::Text: glyph bounds around the pen on the baseline, padded by one pixel
+void Hud::addQuads(std::vector<Vertex>& out, const char* text, const HudGlyph* glyphs, const Vector2f& position, Color color)
+{
+    const float padding = 1.0f;
+    float x = position.x;
+    float y = position.y + static_cast<float>(characterSize);
+    // PressStart2P is monospaced and has no kerning pairs, so the pen only moves by the advance
+    for (const char* c = text; *c; c++) {
+        int code = static_cast<unsigned char>(*c);
+        if (code < 32 || code > 126) code = '?';
+        const HudGlyph& g = glyphs[code];
+        const HudGlyph& pen = fill[code];
+        if (code != ' ') {
+            float left = x + g.bounds.left - padding, top = y + g.bounds.top - padding;
+            float right = x + g.bounds.left + g.bounds.width + padding, bottom = y + g.bounds.top + g.bounds.height + padding;
+            float u1 = static_cast<float>(g.rect.left) - padding, v1 = static_cast<float>(g.rect.top) - padding;
+            float u2 = static_cast<float>(g.rect.left + g.rect.width) + padding, v2 = static_cast<float>(g.rect.top + g.rect.height) + padding;
+            out.push_back(Vertex(Vector2f(left, top), color, Vector2f(u1, v1)));
+            out.push_back(Vertex(Vector2f(right, top), color, Vector2f(u2, v1)));
+            out.push_back(Vertex(Vector2f(left, bottom), color, Vector2f(u1, v2)));
+            out.push_back(Vertex(Vector2f(left, bottom), color, Vector2f(u1, v2)));
+            out.push_back(Vertex(Vector2f(right, top), color, Vector2f(u2, v1)));
+            out.push_back(Vertex(Vector2f(right, bottom), color, Vector2f(u2, v2)));
+        }
+        x += pen.advance;
+    }
+}
+
+void Hud::setField(int index, int value, const char* text)
+{
+    Field& f = fields[index];
+    if (f.value == value) return;
+    f.value = value;
+    f.vertices.clear();
+    addQuads(f.vertices, text, outline, f.position, Color::Black);
+    addQuads(f.vertices, text, fill, f.position, f.color);
+    dirty = true;
+}
+
+void Hud::update(const HudValues& v)
+{
+    char text[maxFieldChars];
+
+    // Each field is formatted only when its value changed
+    if (fields[FieldLaps].value != v.laps) {
+        char* end = appendInt(appendText(text, "Laps: "), v.laps);
+        *appendInt(appendText(end, "/"), TOTAL_LAPS) = '\0';
+        setField(FieldLaps, v.laps, text);
+    }
+    if (fields[FieldVelocity].value != v.speedKmh) {
+        *appendText(appendInt(appendText(text, "Velocity: "), v.speedKmh), " km/h") = '\0';
+        setField(FieldVelocity, v.speedKmh, text);
+    }
+    if (fields[FieldGear].value != v.gear) {
+        *appendInt(appendText(text, "Gear: "), v.gear) = '\0';
+        setField(FieldGear, v.gear, text);
+    }
+    if (fields[FieldPosition].value != v.position) {
+        *appendInt(appendText(text, "Position: "), v.position) = '\0';
+        setField(FieldPosition, v.position, text);
+    }
+    if (fields[FieldGas].value != v.gas) {
+        *appendInt(appendText(text, "Gas: "), v.gas) = '\0';
+        setField(FieldGas, v.gas, text);
+    }
+    setField(FieldGrass, v.onGrass ? 1 : 0, v.onGrass ? "On Grass!" : "");
+
+    if (!dirty) return;
+    dirty = false;
+    batch.clear();
+    for (const Field& f : fields) batch.insert(batch.end(), f.vertices.begin(), f.vertices.end());
+}
+
+void Hud::draw(RenderTarget& target, RenderStats& stats)
+{
+    if (batch.empty()) return;
+    RenderStates states(&font.getTexture(characterSize));
+    target.draw(batch.data(), batch.size(), Triangles, states);
+    stats.drawCalls++;
+    stats.vertices += static_cast<unsigned>(batch.size());
+}
+
+void benchmarkHud(const Font& font)
+{
+    RenderTexture target;
+    if (!target.create(width, height)) {
+        std::cerr << "Failed to create the offscreen target." << std::endl;
+        return;
+    }
+    const int frames = 5000;
+    RenderStats stats;
+
+    // Values change like in a race: speed every frame, gas every few frames, the rest rarely
+    auto values = [](int frame) {
+        HudValues v;
+        v.speedKmh = 100 + frame % 300;
+        v.gas = 100 - frame / 50 % 100;
+        v.laps = frame / 1000;
+        v.gear = 1 + frame / 200 % 5;
+        v.position = 1 + frame / 700 % 3;
+        v.onGrass = frame / 300 % 4 == 0;
+        return v;
+    };
+
+    // Before: six sf::Text rebuilt from std::to_string every frame
+    Text texts[6];
+    const Color colors[6] = { Color::White, Color::White, Color::Yellow, Color::Cyan, Color::White, Color::Red };
+    const float rows[6] = { 60.0f, 100.0f, 140.0f, 180.0f, 300.0f, 340.0f };
+    for (int i = 0; i < 6; i++) {
+        texts[i] = Text("", font, Hud::characterSize);
+        texts[i].setFillColor(colors[i]);
+        texts[i].setPosition(20.0f, rows[i]);
+        texts[i].setOutlineColor(Color::Black);
+        texts[i].setOutlineThickness(outlineThickness);
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; frame++) {
+        HudValues v = values(frame);
+        texts[0].setString("Laps: " + std::to_string(v.laps) + "/" + std::to_string(TOTAL_LAPS));
+        texts[1].setString("Velocity: " + std::to_string(v.speedKmh) + " km/h");
+        texts[2].setString("Gear: " + std::to_string(v.gear));
+        texts[3].setString("Position: " + std::to_string(v.position));
+        texts[4].setString("Gas: " + std::to_string(v.gas));
+        texts[5].setString(v.onGrass ? "On Grass!" : "");
+        for (const Text& t : texts) target.draw(t);
+    }
+    target.display();
+    double textSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Hud hud(font);
+    start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; frame++) {
+        hud.update(values(frame));
+        hud.draw(target, stats);
+    }
+    target.display();
+    double hudSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "HUD, " << frames << " frames: sf::Text " << textSeconds * 1e6 / frames << " us/frame (12 draw calls), cached "
+        << hudSeconds * 1e6 / frames << " us/frame (1 draw call)" << std::endl;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+
+#include "RoadRenderer.h"
+
+#include <vector>
+
+// Values shown by the HUD
+struct HudValues
+{
+    int laps = 0;
+    int speedKmh = 0;
+    int gear = 1;
+    int position = 1;
+    int gas = 0;
+    bool onGrass = false;
+};
+
+// Laid-out quads of one character, in pixels relative to the baseline
+struct HudGlyph
+{
+    sf::FloatRect bounds;
+    sf::IntRect rect; // In the font texture
+    float advance = 0.0f;
+};
+
+// HUD text drawn in one call from the glyphs of the font, baked once at startup.
+// Numbers are formatted into fixed buffers and a field is laid out again only when its value changes;
+// after construction nothing is allocated.
+struct Hud
+{
+    static const unsigned characterSize = 30;
+    static const int fieldCount = 6;
+    static const int maxFieldChars = 32;
+
+    explicit Hud(const sf::Font& font);
+
+    void update(const HudValues& values);
+    void draw(sf::RenderTarget& target, RenderStats& stats);
+
+private:
+    struct Field
+    {
+        sf::Vector2f position;
+        sf::Color color;
+        int value; // Value currently laid out
+        std::vector<sf::Vertex> vertices; // Outline quads, then fill quads
+    };
+
+    const sf::Font& font;
+    HudGlyph fill[128], outline[128]; // Printable ASCII
+    Field fields[fieldCount];
+    std::vector<sf::Vertex> batch; // Every field, drawn in one call
+    bool dirty = true;
+
+    void setField(int index, int value, const char* text);
+    void addQuads(std::vector<sf::Vertex>& out, const char* text, const HudGlyph* glyphs, const sf::Vector2f& position, sf::Color color);
+};
+
+// Time the HUD against six sf::Text updated with std::to_string every frame, drawing offscreen
+void benchmarkHud(const sf::Font& font);
@@ -0,0 +1,70 @@
+#pragma once
+
+// Controls the simulation reads, one bit each
+enum class Control { Accelerate, Left, Right, ShiftUp, ShiftDown, Count };
+
+// Controls of one simulation tick: held at the tick, and pressed or released since the previous one.
+// A tap shorter than a tick shows up as pressed and released without being held.
+struct InputSnapshot
+{
+    unsigned char held = 0;
+    unsigned char pressed = 0;
+    unsigned char released = 0;
+
+    static unsigned char bit(Control c) { return static_cast<unsigned char>(1u << static_cast<int>(c)); }
+
+    bool isHeld(Control c) const { return (held & bit(c)) != 0; }
+    bool wasPressed(Control c) const { return (pressed & bit(c)) != 0; }
+    bool wasReleased(Control c) const { return (released & bit(c)) != 0; }
+
+    // Edges from the controls held at the previous tick, for input that is sampled rather than evented
+    static InputSnapshot fromHeld(unsigned char heldNow, unsigned char heldBefore)
+    {
+        InputSnapshot s;
+        s.held = heldNow;
+        s.pressed = static_cast<unsigned char>(heldNow & ~heldBefore);
+        s.released = static_cast<unsigned char>(heldBefore & ~heldNow);
+        return s;
+    }
+};
+
+// Collects control changes from key events and hands them out as snapshots
+struct InputTracker
+{
+    void press(Control c)
+    {
+        if (down & InputSnapshot::bit(c)) return; // Key repeat
+        down |= InputSnapshot::bit(c);
+        pressed |= InputSnapshot::bit(c);
+    }
+
+    void release(Control c)
+    {
+        if (!(down & InputSnapshot::bit(c))) return;
+        down &= static_cast<unsigned char>(~InputSnapshot::bit(c));
+        released |= InputSnapshot::bit(c);
+    }
+
+    // E.g. when the window loses focus and the key-up events would go elsewhere
+    void releaseAll()
+    {
+        released |= down;
+        down = 0;
+    }
+
+    // Controls held now and the edges since the last call
+    InputSnapshot take()
+    {
+        InputSnapshot s;
+        s.held = down;
+        s.pressed = pressed;
+        s.released = released;
+        pressed = released = 0;
+        return s;
+    }
+
+private:
+    unsigned char down = 0;
+    unsigned char pressed = 0;
+    unsigned char released = 0;
+};
@@ -0,0 +1,187 @@
+#include "Log.h"
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <thread>
+
+std::atomic<int> logCategoryLevel[static_cast<int>(LogCategory::Count)] = {
+    { static_cast<int>(LogLevel::Info) }, { static_cast<int>(LogLevel::Info) }, { static_cast<int>(LogLevel::Info) },
+    { static_cast<int>(LogLevel::Info) }, { static_cast<int>(LogLevel::Info) }
+};
+
+static const char* levelNames[] = { "trace", "debug", "info", "warn", "error", "off" };
+static const char* categoryNames[] = { "race", "player", "opponent", "render", "assets" };
+
+// Bounded multi-producer ring (sequence number per slot); the writer thread is the only consumer.
+// A full buffer drops the message instead of blocking the caller.
+const size_t logCapacity = 1024; // Power of two
+const size_t logMessageSize = 200;
+
+struct LogSlot
+{
+    std::atomic<size_t> seq;
+    LogLevel level;
+    LogCategory category;
+    char text[logMessageSize];
+};
+
+static LogSlot logSlots[logCapacity];
+static std::atomic<size_t> logEnqueuePos(0);
+static size_t logDequeuePos = 0;
+static std::atomic<unsigned> logDropped(0);
+static std::atomic<bool> logRunning(false);
+static std::thread logThread;
+
+static long long nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void logSetLevel(LogCategory category, LogLevel level)
+{
+    logCategoryLevel[static_cast<int>(category)].store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+void logSetLevel(LogLevel level)
+{
+    for (int c = 0; c < static_cast<int>(LogCategory::Count); c++) {
+        logSetLevel(static_cast<LogCategory>(c), level);
+    }
+}
+
+static bool parseLevel(const std::string& name, LogLevel& level)
+{
+    for (int l = 0; l <= static_cast<int>(LogLevel::Off); l++) {
+        if (name == levelNames[l]) {
+            level = static_cast<LogLevel>(l);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool logConfigure(const std::string& spec)
+{
+    size_t start = 0;
+    while (start <= spec.size()) {
+        size_t end = spec.find(',', start);
+        if (end == std::string::npos) end = spec.size();
+        std::string item = spec.substr(start, end - start);
+        start = end + 1;
+        if (item.empty()) continue;
+
+        LogLevel level;
+        size_t eq = item.find('=');
+        if (eq == std::string::npos) {
+            if (!parseLevel(item, level)) return false;
+            logSetLevel(level);
+            continue;
+        }
+
+        std::string category = item.substr(0, eq);
+        if (!parseLevel(item.substr(eq + 1), level)) return false;
+        bool found = false;
+        for (int c = 0; c < static_cast<int>(LogCategory::Count); c++) {
+            if (category == categoryNames[c]) {
+                logSetLevel(static_cast<LogCategory>(c), level);
+                found = true;
+            }
+        }
+        if (!found) return false;
+    }
+    return true;
+}
+
+void logWrite(LogLevel level, LogCategory category, const char* format, ...)
+{
+    size_t pos = logEnqueuePos.load(std::memory_order_relaxed);
+    LogSlot* slot;
+    for (;;) {
+        slot = &logSlots[pos & (logCapacity - 1)];
+        size_t seq = slot->seq.load(std::memory_order_acquire);
+        long long diff = static_cast<long long>(seq) - static_cast<long long>(pos);
+        if (diff == 0) {
+            if (logEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        }
+        else if (diff < 0) {
+            logDropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        else {
+            pos = logEnqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->level = level;
+    slot->category = category;
+    va_list args;
+    va_start(args, format);
+    std::vsnprintf(slot->text, logMessageSize, format, args);
+    va_end(args);
+    slot->seq.store(pos + 1, std::memory_order_release);
+}
+
+// Write everything that is ready; returns the number of messages written
+static int logDrain()
+{
+    int written = 0;
+    for (;;) {
+        LogSlot& slot = logSlots[logDequeuePos & (logCapacity - 1)];
+        if (slot.seq.load(std::memory_order_acquire) != logDequeuePos + 1) break;
+
+        std::fprintf(stdout, "[%s] [%s] %s\n", levelNames[static_cast<int>(slot.level)],
+            categoryNames[static_cast<int>(slot.category)], slot.text);
+        slot.seq.store(logDequeuePos + logCapacity, std::memory_order_release);
+        logDequeuePos++;
+        written++;
+    }
+
+    unsigned dropped = logDropped.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0) {
+        std::fprintf(stdout, "[warn] [log] %u messages dropped, buffer full\n", dropped);
+        written++;
+    }
+    if (written > 0) std::fflush(stdout);
+    return written;
+}
+
+static void logThreadMain()
+{
+    while (logRunning.load(std::memory_order_acquire)) {
+        if (logDrain() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    logDrain();
+}
+
+LogSession::LogSession()
+{
+    for (size_t i = 0; i < logCapacity; i++) logSlots[i].seq.store(i, std::memory_order_relaxed);
+    logEnqueuePos.store(0, std::memory_order_relaxed);
+    logDequeuePos = 0;
+    logRunning.store(true, std::memory_order_release);
+    logThread = std::thread(logThreadMain);
+}
+
+LogSession::~LogSession()
+{
+    logRunning.store(false, std::memory_order_release);
+    if (logThread.joinable()) logThread.join();
+}
+
+LogRateLimit::LogRateLimit(double intervalSeconds)
+    : intervalNs(static_cast<long long>(intervalSeconds * 1e9)), nextNs(0), suppressed(0)
+{
+}
+
+bool LogRateLimit::allow(int& suppressedSinceLast)
+{
+    long long now = nowNs();
+    long long next = nextNs.load(std::memory_order_relaxed);
+    if (now < next || !nextNs.compare_exchange_strong(next, now + intervalNs, std::memory_order_relaxed)) {
+        suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    suppressedSinceLast = suppressed.exchange(0, std::memory_order_relaxed);
+    return true;
+}
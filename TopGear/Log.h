@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+// Asynchronous logging.
+// LOG_* calls format into a lock-free ring buffer and return; a background thread writes
+// the messages to stdout. Levels below LOG_COMPILE_LEVEL are removed by the preprocessor,
+// the rest are filtered per category at runtime.
+
+enum class LogLevel { Trace, Debug, Info, Warn, Error, Off };
+enum class LogCategory { Race, Player, Opponent, Render, Assets, Count };
+
+// 0 = Trace ... 4 = Error. Release builds drop Trace and Debug entirely.
+#ifndef LOG_COMPILE_LEVEL
+#ifdef NDEBUG
+#define LOG_COMPILE_LEVEL 2
+#else
+#define LOG_COMPILE_LEVEL 0
+#endif
+#endif
+
+extern std::atomic<int> logCategoryLevel[static_cast<int>(LogCategory::Count)];
+
+inline bool logEnabled(LogCategory category, LogLevel level)
+{
+    return static_cast<int>(level) >= logCategoryLevel[static_cast<int>(category)].load(std::memory_order_relaxed);
+}
+
+void logSetLevel(LogCategory category, LogLevel level);
+void logSetLevel(LogLevel level); // All categories
+// Parse "level" or "category=level" pairs separated by commas, e.g. "info,opponent=debug,render=off"
+bool logConfigure(const std::string& spec);
+
+void logWrite(LogLevel level, LogCategory category, const char* format, ...)
+#if defined(__GNUC__)
+    __attribute__((format(printf, 3, 4)))
+#endif
+    ;
+
+// Starts the writer thread; the destructor drains the buffer and stops it
+struct LogSession
+{
+    LogSession();
+    ~LogSession();
+};
+
+// Lets a message through at most once per interval and counts the ones it held back
+struct LogRateLimit
+{
+    long long intervalNs;
+    std::atomic<long long> nextNs;
+    std::atomic<int> suppressed;
+
+    explicit LogRateLimit(double intervalSeconds);
+    bool allow(int& suppressedSinceLast);
+};
+
+#define LOG_AT(level, category, ...) \
+    do { if (logEnabled(category, level)) logWrite(level, category, __VA_ARGS__); } while (0)
+
+// Rate-limited variant for messages issued every frame or tick
+#define LOG_AT_EVERY(seconds, level, category, ...) \
+    do { \
+        if (logEnabled(category, level)) { \
+            static LogRateLimit logLimit_(seconds); \
+            int logSuppressed_ = 0; \
+            if (logLimit_.allow(logSuppressed_)) { \
+                logWrite(level, category, __VA_ARGS__); \
+                if (logSuppressed_ > 0) logWrite(level, category, "(%d similar messages suppressed)", logSuppressed_); \
+            } \
+        } \
+    } while (0)
+
+#define LOG_NOTHING() do { } while (0)
+
+#if LOG_COMPILE_LEVEL <= 0
+#define LOG_TRACE(category, ...) LOG_AT(LogLevel::Trace, category, __VA_ARGS__)
+#define LOG_TRACE_EVERY(seconds, category, ...) LOG_AT_EVERY(seconds, LogLevel::Trace, category, __VA_ARGS__)
+#else
+#define LOG_TRACE(category, ...) LOG_NOTHING()
+#define LOG_TRACE_EVERY(seconds, category, ...) LOG_NOTHING()
+#endif
+
+#if LOG_COMPILE_LEVEL <= 1
+#define LOG_DEBUG(category, ...) LOG_AT(LogLevel::Debug, category, __VA_ARGS__)
+#define LOG_DEBUG_EVERY(seconds, category, ...) LOG_AT_EVERY(seconds, LogLevel::Debug, category, __VA_ARGS__)
+#else
+#define LOG_DEBUG(category, ...) LOG_NOTHING()
+#define LOG_DEBUG_EVERY(seconds, category, ...) LOG_NOTHING()
+#endif
+
+#if LOG_COMPILE_LEVEL <= 2
+#define LOG_INFO(category, ...) LOG_AT(LogLevel::Info, category, __VA_ARGS__)
+#define LOG_INFO_EVERY(seconds, category, ...) LOG_AT_EVERY(seconds, LogLevel::Info, category, __VA_ARGS__)
+#else
+#define LOG_INFO(category, ...) LOG_NOTHING()
+#define LOG_INFO_EVERY(seconds, category, ...) LOG_NOTHING()
+#endif
+
+#define LOG_WARN(category, ...) LOG_AT(LogLevel::Warn, category, __VA_ARGS__)
+#define LOG_ERROR(category, ...) LOG_AT(LogLevel::Error, category, __VA_ARGS__)
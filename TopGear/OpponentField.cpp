@@ -0,0 +1,286 @@
+#include "OpponentField.h"
+#include "GameConstants.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define OPPONENTS_SSE 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define OPPONENTS_NEON 1
+#include <arm_neon.h>
+#endif
+
+const float steerSpeed = 0.3f; // Rate of lateral movement
+const float overtakeSteerSpeed = 4.0f; // Rate of lateral movement while passing a car
+const float opponentAcceleration = 40.0f; // Speed change per second back to the base speed after a bump or a slower car
+const float overtakeSeconds = 0.6f; // How far ahead a car looks for slower cars in its way, in time at its speed
+const int overtakeCars = 6; // and at most how many cars: in a dense field the nearest ones hide the others
+const float followGap = 2.0f * carLength; // A car with no room to pass slows down this close to the car ahead
+const float passingGap = 2.0f * carHalfWidth + 0.1f; // Lateral distance from a car to pass it at
+
+void OpponentField::clear()
+{
+    pos.clear();
+    x.clear();
+    speed.clear();
+    baseSpeed.clear();
+    laps.clear();
+    targetX.clear();
+    finished.clear();
+    curve.clear();
+    natural.clear();
+    line.clear();
+    follow.clear();
+    active.clear();
+}
+
+void OpponentField::add(float startPos, float startX, float spd)
+{
+    pos.push_back(startPos);
+    x.push_back(startX);
+    speed.push_back(spd);
+    baseSpeed.push_back(spd);
+    laps.push_back(0);
+    targetX.push_back(startX);
+    finished.push_back(0);
+    curve.push_back(0.0f);
+    natural.push_back(0.0f);
+    line.push_back(0.0f);
+    follow.push_back(spd);
+    active.push_back(0.0f);
+}
+
+// Racing line from the curve under each car, toward the inside of the curve and within the road
+static void naturalScalar(const float* curve, float* natural, int begin, int count)
+{
+    for (int i = begin; i < count; i++) {
+        float line = -curve[i] * 0.5f;
+        if (line > maxOpponentX) line = maxOpponentX;
+        if (line < -maxOpponentX) line = -maxOpponentX;
+        natural[i] = line;
+    }
+}
+
+// Speeds back toward the base speed and held to the car ahead (follow), then the cars move and steer
+// toward their line, faster when it is not the racing line, from car begin to count.
+// Finished cars keep their position. Same operations in the same order in every version,
+// so the vector loops give bit-identical results to the scalar one.
+static void moveScalar(OpponentField& f, const float* line, const float* natural, const float* follow, const float* active, int begin, int count, float elapsedSeconds)
+{
+    const float accel = opponentAcceleration * elapsedSeconds;
+    for (int i = begin; i < count; i++) {
+        float speed = f.speed[i], base = f.baseSpeed[i];
+        if (speed < base) speed = std::min(base, speed + accel);
+        else if (speed > base) speed = std::max(base, speed - accel);
+        if (follow[i] < speed) speed = follow[i];
+        f.speed[i] = speed;
+
+        if (active[i] == 0.0f) continue;
+
+        f.pos[i] += speed * elapsedSeconds * 125.0f; // Match player's speed scaling
+
+        float target = line[i];
+        f.targetX[i] = target;
+
+        float steer = target != natural[i] ? overtakeSteerSpeed : steerSpeed;
+        float lateral = f.x[i] + (target - f.x[i]) * steer * elapsedSeconds;
+        if (lateral > maxOpponentX) lateral = maxOpponentX;
+        if (lateral < -maxOpponentX) lateral = -maxOpponentX;
+        f.x[i] = lateral;
+    }
+}
+
+#ifdef OPPONENTS_SSE
+static __m128 select(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static void naturalVector(const float* curve, float* natural, int count)
+{
+    const __m128 half = _mm_set1_ps(-0.5f), hi = _mm_set1_ps(maxOpponentX), lo = _mm_set1_ps(-maxOpponentX);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 line = _mm_mul_ps(_mm_loadu_ps(curve + i), half);
+        _mm_storeu_ps(natural + i, _mm_max_ps(_mm_min_ps(line, hi), lo));
+    }
+    naturalScalar(curve, natural, i, count);
+}
+
+static void moveVector(OpponentField& f, const float* line, const float* natural, const float* follow, const float* active, int count, float elapsedSeconds)
+{
+    const __m128 dt = _mm_set1_ps(elapsedSeconds), speedScale = _mm_set1_ps(125.0f);
+    const __m128 accel = _mm_set1_ps(opponentAcceleration * elapsedSeconds);
+    const __m128 slowSteer = _mm_set1_ps(steerSpeed), fastSteer = _mm_set1_ps(overtakeSteerSpeed);
+    const __m128 hi = _mm_set1_ps(maxOpponentX), lo = _mm_set1_ps(-maxOpponentX), zero = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 speed = _mm_loadu_ps(&f.speed[i]), base = _mm_loadu_ps(&f.baseSpeed[i]);
+        __m128 up = _mm_min_ps(_mm_add_ps(speed, accel), base);
+        __m128 down = _mm_max_ps(_mm_sub_ps(speed, accel), base);
+        speed = select(_mm_cmplt_ps(speed, base), up, select(_mm_cmpgt_ps(speed, base), down, speed));
+        speed = _mm_min_ps(_mm_loadu_ps(follow + i), speed);
+        _mm_storeu_ps(&f.speed[i], speed);
+
+        __m128 racing = _mm_cmpneq_ps(_mm_loadu_ps(active + i), zero);
+
+        __m128 p = _mm_loadu_ps(&f.pos[i]);
+        __m128 moved = _mm_add_ps(p, _mm_mul_ps(_mm_mul_ps(speed, dt), speedScale));
+        _mm_storeu_ps(&f.pos[i], select(racing, moved, p));
+
+        __m128 target = _mm_loadu_ps(line + i);
+        _mm_storeu_ps(&f.targetX[i], select(racing, target, _mm_loadu_ps(&f.targetX[i])));
+
+        __m128 steer = select(_mm_cmpneq_ps(target, _mm_loadu_ps(natural + i)), fastSteer, slowSteer);
+        __m128 lx = _mm_loadu_ps(&f.x[i]);
+        __m128 lateral = _mm_add_ps(lx, _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(target, lx), steer), dt));
+        lateral = _mm_max_ps(_mm_min_ps(lateral, hi), lo);
+        _mm_storeu_ps(&f.x[i], select(racing, lateral, lx));
+    }
+    moveScalar(f, line, natural, follow, active, i, count, elapsedSeconds);
+}
+#elif defined(OPPONENTS_NEON)
+static void naturalVector(const float* curve, float* natural, int count)
+{
+    const float32x4_t half = vdupq_n_f32(-0.5f), hi = vdupq_n_f32(maxOpponentX), lo = vdupq_n_f32(-maxOpponentX);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t line = vmulq_f32(vld1q_f32(curve + i), half);
+        vst1q_f32(natural + i, vmaxq_f32(vminq_f32(line, hi), lo));
+    }
+    naturalScalar(curve, natural, i, count);
+}
+
+static void moveVector(OpponentField& f, const float* line, const float* natural, const float* follow, const float* active, int count, float elapsedSeconds)
+{
+    const float32x4_t dt = vdupq_n_f32(elapsedSeconds), speedScale = vdupq_n_f32(125.0f);
+    const float32x4_t accel = vdupq_n_f32(opponentAcceleration * elapsedSeconds);
+    const float32x4_t slowSteer = vdupq_n_f32(steerSpeed), fastSteer = vdupq_n_f32(overtakeSteerSpeed);
+    const float32x4_t hi = vdupq_n_f32(maxOpponentX), lo = vdupq_n_f32(-maxOpponentX), zero = vdupq_n_f32(0.0f);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t speed = vld1q_f32(&f.speed[i]), base = vld1q_f32(&f.baseSpeed[i]);
+        float32x4_t up = vminq_f32(vaddq_f32(speed, accel), base);
+        float32x4_t down = vmaxq_f32(vsubq_f32(speed, accel), base);
+        speed = vbslq_f32(vcltq_f32(speed, base), up, vbslq_f32(vcgtq_f32(speed, base), down, speed));
+        speed = vminq_f32(vld1q_f32(follow + i), speed);
+        vst1q_f32(&f.speed[i], speed);
+
+        uint32x4_t finishedLanes = vceqq_f32(vld1q_f32(active + i), zero);
+
+        float32x4_t p = vld1q_f32(&f.pos[i]);
+        float32x4_t moved = vaddq_f32(p, vmulq_f32(vmulq_f32(speed, dt), speedScale));
+        vst1q_f32(&f.pos[i], vbslq_f32(finishedLanes, p, moved));
+
+        float32x4_t target = vld1q_f32(line + i);
+        vst1q_f32(&f.targetX[i], vbslq_f32(finishedLanes, vld1q_f32(&f.targetX[i]), target));
+
+        float32x4_t steer = vbslq_f32(vceqq_f32(target, vld1q_f32(natural + i)), slowSteer, fastSteer);
+        float32x4_t lx = vld1q_f32(&f.x[i]);
+        float32x4_t lateral = vaddq_f32(lx, vmulq_f32(vmulq_f32(vsubq_f32(target, lx), steer), dt));
+        lateral = vmaxq_f32(vminq_f32(lateral, hi), lo);
+        vst1q_f32(&f.x[i], vbslq_f32(finishedLanes, lx, lateral));
+    }
+    moveScalar(f, line, natural, follow, active, i, count, elapsedSeconds);
+}
+#else
+static void naturalVector(const float* curve, float* natural, int count)
+{
+    naturalScalar(curve, natural, 0, count);
+}
+
+static void moveVector(OpponentField& f, const float* line, const float* natural, const float* follow, const float* active, int count, float elapsedSeconds)
+{
+    moveScalar(f, line, natural, follow, active, 0, count, elapsedSeconds);
+}
+#endif
+
+// Line to steer to: toward the inside of the curve, or beside the nearest slower car in the way
+// of the car or of that line, on the nearer side that the slower cars in sight leave room on.
+// The cars in sight are the few nearest ahead, so the cost per car does not grow with the field.
+// With no room on either side the car keeps its line, and follows at the speed of the other (followSpeed)
+// once it gets close.
+float OpponentField::overtakingLine(int i, float natural, double trackLength, const RaceStandings& standings, const Traffic& traffic, float& followSpeed)
+{
+    const int car = i + 1;
+    const double d = traffic.distanceOf(standings, car);
+    near.clear();
+    traffic.carsAhead(standings, d, d + speed[i] * 125.0f * overtakeSeconds, car, overtakeCars, near);
+
+    int blocker = -1;
+    double blockerGap = 0.0;
+    for (int other : near) {
+        if (traffic.speed[other] >= speed[i]) continue;
+        if (std::abs(traffic.x[other] - x[i]) >= passingGap && std::abs(traffic.x[other] - natural) >= passingGap) continue;
+        double gap = traffic.distanceOf(standings, other) - d;
+        gap -= std::floor(gap / trackLength) * trackLength; // Whole laps ahead or behind on a looping track
+        if (blocker < 0 || gap < blockerGap) {
+            blocker = other;
+            blockerGap = gap;
+        }
+    }
+    if (blocker < 0) return natural;
+
+    float best = natural;
+    bool found = false;
+    for (float side : { -1.0f, 1.0f }) {
+        float candidate = std::max(-maxOpponentX, std::min(maxOpponentX, traffic.x[blocker] + side * passingGap));
+        if (std::abs(candidate - traffic.x[blocker]) < 2.0f * carHalfWidth) continue; // No room on that side
+        bool clear = true;
+        for (int other : near) {
+            // Faster cars pull away; slower ones on that line would be in the way next
+            if (other != blocker && traffic.speed[other] < speed[i] && std::abs(traffic.x[other] - candidate) < 2.0f * carHalfWidth) clear = false;
+        }
+        if (clear && (!found || std::abs(candidate - x[i]) < std::abs(best - x[i]))) {
+            best = candidate;
+            found = true;
+        }
+    }
+    if (!found && blockerGap < followGap) followSpeed = traffic.speed[blocker];
+    return best;
+}
+
+void OpponentField::update(float elapsedSeconds, const Track& track, bool raceStarted, const RaceStandings& standings, const Traffic& traffic)
+{
+    if (!raceStarted) return;
+
+    const int n = track.size();
+    const int count = size();
+    const float trackLength = static_cast<float>(n * segL);
+
+    // Curve of the segment each car is on before it moves; the racing line is toward its inside
+    for (int i = 0; i < count; i++) {
+        int segment = static_cast<int>(pos[i] / segL);
+        if (segment >= n) segment -= n;
+        curve[i] = track.curveAt(laps[i], segment);
+        active[i] = finished[i] ? 0.0f : 1.0f;
+    }
+    naturalVector(curve.data(), natural.data(), count);
+
+    // Cars ahead: a walk over the few nearest in the standings, per car
+    for (int i = 0; i < count; i++) {
+        follow[i] = baseSpeed[i];
+        line[i] = active[i] != 0.0f ? overtakingLine(i, natural[i], trackLength, standings, traffic, follow[i]) : natural[i];
+    }
+
+    moveVector(*this, line.data(), natural.data(), follow.data(), active.data(), count, elapsedSeconds);
+
+    // Laps: only the few cars that crossed the line take the branch
+    const long long finish = track.finishDistance(TOTAL_LAPS);
+    for (int i = 0; i < count; i++) {
+        if (active[i] == 0.0f) continue;
+        while (pos[i] >= trackLength) {
+            pos[i] -= trackLength;
+            laps[i]++;
+        }
+        int segment = std::min(static_cast<int>(pos[i] / segL), n - 1);
+        if (track.distance(laps[i], segment) >= finish) {
+            finished[i] = 1;
+            LOG_INFO(LogCategory::Opponent, "Opponent %d finished race!", i);
+        }
+    }
+    if (count > 0) LOG_DEBUG_EVERY(0.5, LogCategory::Opponent, "Opponent 0 pos: %g, laps: %d", pos[0], laps[0]);
+}
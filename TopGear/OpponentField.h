@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Track.h"
+#include "Traffic.h"
+
+#include <vector>
+
+// AI cars stored as packed arrays, all indexed by car, so one tick updates the whole field
+// in vector loops: the racing line from the curve under each car, the speed and steering toward the
+// line, and the movement. Only the gather of the curve and the look at the cars ahead are per car.
+// Opponent i is car i + 1 of the standings and the traffic.
+struct OpponentField
+{
+    std::vector<float> pos; // Position along track
+    std::vector<float> x; // Lateral position
+    std::vector<float> speed; // Current speed
+    std::vector<float> baseSpeed; // Base speed (constant)
+    std::vector<int> laps; // Laps completed
+    std::vector<float> targetX; // Target lateral position for smoother movement
+    std::vector<unsigned char> finished; // Whether the car has finished the race
+
+    int size() const { return static_cast<int>(pos.size()); }
+    void clear();
+    void add(float startPos, float startX, float spd);
+
+    // Cars see each other as of the last tick, through the standings and the traffic
+    void update(float elapsedSeconds, const Track& track, bool raceStarted, const RaceStandings& standings, const Traffic& traffic);
+
+private:
+    // Per-tick scratch: curve under each car, its racing line, the line it steers to, the speed of the car
+    // it follows (its base speed when the road is clear), and 1 for cars still racing, 0 for finished ones
+    std::vector<float> curve;
+    std::vector<float> natural;
+    std::vector<float> line;
+    std::vector<float> follow;
+    std::vector<float> active;
+    std::vector<int> near;
+
+    float overtakingLine(int i, float natural, double trackLength, const RaceStandings& standings, const Traffic& traffic, float& followSpeed);
+};
+
+const float maxOpponentX = 0.8f; // Tighter limit to stay on road
@@ -0,0 +1,99 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+
+FrameProfiler frameProfiler;
+const int FrameProfiler::historySize; // std::min takes it by reference
+
+static const char* phaseNames[] = {
+    "Events", "Input", "Opp update", "Physics", "Ranking", "Traffic", "HUD",
+    "Projection", "Road", "Sprites", "Culling", "Display",
+    "Sim stage", "Draw stage", "Overlap"
+};
+
+const char* profilePhaseName(ProfilePhase phase)
+{
+    return phaseNames[static_cast<int>(phase)];
+}
+
+long long profileNowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+FrameProfiler::FrameProfiler()
+{
+    for (int p = 0; p < phaseCount; p++) {
+        currentNs[p].store(0, std::memory_order_relaxed);
+        std::fill(history[p], history[p] + historySize, 0.0f);
+    }
+    std::fill(frameHistory, frameHistory + historySize, 0.0f);
+    for (int c = 0; c < counterCount; c++) {
+        currentCount[c] = 0;
+        std::fill(countHistory[c], countHistory[c] + historySize, 0);
+    }
+}
+
+void FrameProfiler::beginFrame()
+{
+    frameStartNs = profileNowNs();
+}
+
+void FrameProfiler::endFrame()
+{
+    int slot = frames % historySize;
+    for (int p = 0; p < phaseCount; p++) {
+        history[p][slot] = static_cast<float>(currentNs[p].exchange(0, std::memory_order_relaxed)) / 1e6f;
+    }
+    for (int c = 0; c < counterCount; c++) {
+        countHistory[c][slot] = currentCount[c];
+        currentCount[c] = 0;
+    }
+    frameHistory[slot] = static_cast<float>(profileNowNs() - frameStartNs) / 1e6f;
+    frames++;
+}
+
+void FrameProfiler::addStages(long long simStartNs, long long simEndNs, long long drawStartNs, long long drawEndNs)
+{
+    long long overlapNs = std::min(simEndNs, drawEndNs) - std::max(simStartNs, drawStartNs);
+    add(ProfilePhase::SimStage, simEndNs - simStartNs);
+    add(ProfilePhase::RenderStage, drawEndNs - drawStartNs);
+    add(ProfilePhase::StageOverlap, std::max(overlapNs, 0LL));
+}
+
+static PhaseStats computeStats(const float* samples, int count)
+{
+    PhaseStats s;
+    if (count == 0) return s;
+
+    float sorted[FrameProfiler::historySize];
+    std::copy(samples, samples + count, sorted);
+    std::sort(sorted, sorted + count);
+
+    float sum = 0.0f;
+    for (int i = 0; i < count; i++) sum += sorted[i];
+    s.minMs = sorted[0];
+    s.avgMs = sum / count;
+    s.p99Ms = sorted[std::min(count - 1, (count * 99) / 100)];
+    return s;
+}
+
+PhaseStats FrameProfiler::stats(ProfilePhase phase) const
+{
+    return computeStats(history[static_cast<int>(phase)], std::min(frames, historySize));
+}
+
+PhaseStats FrameProfiler::frameStats() const
+{
+    return computeStats(frameHistory, std::min(frames, historySize));
+}
+
+float FrameProfiler::countAverage(ProfileCounter counter) const
+{
+    int count = std::min(frames, historySize);
+    if (count == 0) return 0.0f;
+    long long sum = 0;
+    for (int i = 0; i < count; i++) sum += countHistory[static_cast<int>(counter)][i];
+    return static_cast<float>(sum) / count;
+}
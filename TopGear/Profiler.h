@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+
+// Per-phase frame timing.
+// PROFILE_SCOPE adds the time spent in a block to its phase for the current frame;
+// PROFILE_FRAME_END moves the frame totals into a rolling history. With TOPGEAR_PROFILE
+// set to 0 (the release default) the macros expand to nothing.
+
+#ifndef TOPGEAR_PROFILE
+#ifdef NDEBUG
+#define TOPGEAR_PROFILE 0
+#else
+#define TOPGEAR_PROFILE 1
+#endif
+#endif
+
+enum class ProfilePhase
+{
+    EventPoll, Input, OpponentUpdate, PlayerPhysics, Ranking, Traffic, Hud,
+    Projection, RoadEmission, SpritePass, Culling, Display,
+    SimStage, RenderStage, StageOverlap, // Pipelined frame: time of each stage and how long both ran at once
+    Count
+};
+
+const char* profilePhaseName(ProfilePhase phase);
+
+// Per-frame counts, averaged over the same history as the phases
+enum class ProfileCounter
+{
+    RoadHidden, RoadOffScreen, RoadDrawn, SpritesHidden, SpritesOffScreen, SpritesDrawn, CarsHidden, CarsOffScreen, CarsDrawn,
+    Count
+};
+
+// Milliseconds over the history window
+struct PhaseStats
+{
+    float minMs = 0.0f;
+    float avgMs = 0.0f;
+    float p99Ms = 0.0f;
+};
+
+struct FrameProfiler
+{
+    static const int phaseCount = static_cast<int>(ProfilePhase::Count);
+    static const int counterCount = static_cast<int>(ProfileCounter::Count);
+    static const int historySize = 240; // Frames
+
+    std::atomic<long long> currentNs[phaseCount];
+    float history[phaseCount][historySize];
+    int currentCount[counterCount]; // Counted by the render thread only
+    int countHistory[counterCount][historySize];
+    float frameHistory[historySize];
+    int frames = 0; // Frames recorded so far
+    long long frameStartNs = 0;
+
+    FrameProfiler();
+
+    void beginFrame();
+    void endFrame();
+    void add(ProfilePhase phase, long long ns) { currentNs[static_cast<int>(phase)].fetch_add(ns, std::memory_order_relaxed); }
+    void count(ProfileCounter counter, int n) { currentCount[static_cast<int>(counter)] += n; }
+    // Time of each pipeline stage and how long both ran at once
+    void addStages(long long simStartNs, long long simEndNs, long long drawStartNs, long long drawEndNs);
+
+    PhaseStats stats(ProfilePhase phase) const;
+    PhaseStats frameStats() const;
+    float countAverage(ProfileCounter counter) const;
+};
+
+extern FrameProfiler frameProfiler;
+
+long long profileNowNs();
+
+struct ProfileScope
+{
+    ProfilePhase phase;
+    long long start;
+
+    explicit ProfileScope(ProfilePhase p) : phase(p), start(profileNowNs()) {}
+    ~ProfileScope() { frameProfiler.add(phase, profileNowNs() - start); }
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#if TOPGEAR_PROFILE
+#define PROFILE_SCOPE(phase) ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(phase)
+#define PROFILE_FRAME_BEGIN() frameProfiler.beginFrame()
+#define PROFILE_FRAME_END() frameProfiler.endFrame()
+#define PROFILE_STAGES(simStart, simEnd, drawStart, drawEnd) frameProfiler.addStages(simStart, simEnd, drawStart, drawEnd)
+#define PROFILE_COUNT(counter, n) frameProfiler.count(counter, n)
+#else
+#define PROFILE_SCOPE(phase) do { } while (0)
+#define PROFILE_FRAME_BEGIN() do { } while (0)
+#define PROFILE_FRAME_END() do { } while (0)
+#define PROFILE_STAGES(simStart, simEnd, drawStart, drawEnd) do { (void)sizeof((simStart) + (simEnd) + (drawStart) + (drawEnd)); } while (0)
+#define PROFILE_COUNT(counter, n) do { (void)sizeof(n); } while (0)
+#endif
@@ -0,0 +1,65 @@
+#include "ProfilerOverlay.h"
+#include "Profiler.h"
+
+#include <cstdio>
+#include <string>
+
+using namespace sf;
+
+ProfilerOverlay::ProfilerOverlay(const Font& font)
+    : text("", font, 10)
+{
+    text.setFillColor(Color::White);
+    text.setPosition(680.0f, 20.0f);
+    text.setLineSpacing(1.4f);
+    background.setFillColor(Color(0, 0, 0, 170));
+}
+
+void ProfilerOverlay::draw(RenderTarget& target, const RenderStats& stats)
+{
+    if (!visible) return;
+
+    if (refreshClock.getElapsedTime().asSeconds() >= 0.25f || text.getString().isEmpty()) {
+        refreshClock.restart();
+
+        char line[96];
+        std::string table = "Phase        min   avg   p99 ms\n";
+#if TOPGEAR_PROFILE
+        for (int p = 0; p < FrameProfiler::phaseCount; p++) {
+            PhaseStats s = frameProfiler.stats(static_cast<ProfilePhase>(p));
+            std::snprintf(line, sizeof(line), "%-11s %5.2f %5.2f %5.2f\n", profilePhaseName(static_cast<ProfilePhase>(p)), s.minMs, s.avgMs, s.p99Ms);
+            table += line;
+        }
+        PhaseStats f = frameProfiler.frameStats();
+        std::snprintf(line, sizeof(line), "%-11s %5.2f %5.2f %5.2f\n", "Frame", f.minMs, f.avgMs, f.p99Ms);
+        table += line;
+
+        // Objects culled per frame, on average, by reason
+        auto count = [](ProfileCounter c) { return frameProfiler.countAverage(c); };
+        table += "Culled      hidden beside  drawn\n";
+        std::snprintf(line, sizeof(line), "%-11s %6.1f %6.1f %6.1f\n", "Road",
+            count(ProfileCounter::RoadHidden), count(ProfileCounter::RoadOffScreen), count(ProfileCounter::RoadDrawn));
+        table += line;
+        std::snprintf(line, sizeof(line), "%-11s %6.1f %6.1f %6.1f\n", "Sprites",
+            count(ProfileCounter::SpritesHidden), count(ProfileCounter::SpritesOffScreen), count(ProfileCounter::SpritesDrawn));
+        table += line;
+        std::snprintf(line, sizeof(line), "%-11s %6.1f %6.1f %6.1f\n", "Cars",
+            count(ProfileCounter::CarsHidden), count(ProfileCounter::CarsOffScreen), count(ProfileCounter::CarsDrawn));
+        table += line;
+#else
+        table += "(profiling disabled in this build)\n";
+#endif
+        std::snprintf(line, sizeof(line), "Draw calls %u  Vertices %u\n", stats.drawCalls, stats.vertices);
+        table += line;
+        std::snprintf(line, sizeof(line), "Sprite calls %u (%u in depth order)", stats.spriteCalls, stats.spriteCallsDepthOrder);
+        table += line;
+        text.setString(table);
+
+        FloatRect bounds = text.getGlobalBounds();
+        background.setPosition(bounds.left - 8.0f, bounds.top - 8.0f);
+        background.setSize(Vector2f(bounds.width + 16.0f, bounds.height + 16.0f));
+    }
+
+    target.draw(background);
+    target.draw(text);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+
+#include "RoadRenderer.h"
+
+// On-screen table of the frame profiler phases plus the draw-call counters
+struct ProfilerOverlay
+{
+    bool visible = false;
+    sf::Text text;
+    sf::RectangleShape background;
+    sf::Clock refreshClock;
+
+    explicit ProfilerOverlay(const sf::Font& font);
+
+    void toggle() { visible = !visible; }
+    // Rebuilds the table a few times per second, not every frame
+    void draw(sf::RenderTarget& target, const RenderStats& stats);
+};
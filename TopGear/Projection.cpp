@@ -0,0 +1,240 @@
+#include "Projection.h"
+#include "GameConstants.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PROJECTION_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define PROJECTION_NEON 1
+#include <arm_neon.h>
+#endif
+
+// GCC and Clang need the instruction set enabled per function; MSVC accepts the intrinsics anywhere
+#if defined(PROJECTION_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_SSE __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE
+#define TARGET_AVX2
+#endif
+
+void ProjectedTrack::resize(int n)
+{
+    X.assign(n, 0.0f);
+    Y.assign(n, 0.0f);
+    W.assign(n, 0.0f);
+    scale.assign(n, 0.0f);
+    clip.assign(n, 0.0f);
+    roadX.assign(n, 0.0f);
+}
+
+void projectSegment(const Track& track, ProjectedTrack& proj, int i, float camX, float camY, float camZ)
+{
+    float s = camD / (track.z[i] - camZ);
+    proj.scale[i] = s;
+    proj.X[i] = (1.0f - s * camX) * width / 2.0f;
+    proj.Y[i] = (1.0f - s * (track.y[i] - camY)) * height / 2.0f;
+    proj.W[i] = s * roadW * width / 2.0f;
+}
+
+// Arrays of one batch, all starting at the first segment
+struct ProjectionBatch
+{
+    const float* z;
+    const float* y;
+    const float* roadX;
+    float* X;
+    float* Y;
+    float* W;
+    float* scale;
+};
+
+typedef void (*ProjectionFn)(const ProjectionBatch& b, int begin, int count, const ProjectionCamera& cam);
+
+// Same arithmetic as projectSegment, in the same order, so every kernel matches it to rounding.
+// Inlined into the vector kernels for their last segments.
+static inline void projectOne(const ProjectionBatch& b, int i, const ProjectionCamera& cam)
+{
+    float s = camD / (b.z[i] - cam.z);
+    b.scale[i] = s;
+    b.X[i] = (1.0f - s * (cam.x - b.roadX[i])) * width / 2.0f;
+    b.Y[i] = (1.0f - s * (b.y[i] - cam.y)) * height / 2.0f;
+    b.W[i] = s * roadW * width / 2.0f;
+}
+
+static void projectScalar(const ProjectionBatch& b, int begin, int count, const ProjectionCamera& cam)
+{
+    for (int i = begin; i < count; i++) projectOne(b, i, cam);
+}
+
+#ifdef PROJECTION_X86
+TARGET_SSE static void projectSSE(const ProjectionBatch& b, int begin, int count, const ProjectionCamera& cam)
+{
+    const __m128 one = _mm_set1_ps(1.0f), d = _mm_set1_ps(camD);
+    const __m128 halfW = _mm_set1_ps(width / 2.0f), halfH = _mm_set1_ps(height / 2.0f);
+    const __m128 roadHalfW = _mm_set1_ps(roadW * width / 2.0f);
+    const __m128 cx = _mm_set1_ps(cam.x), cy = _mm_set1_ps(cam.y), cz = _mm_set1_ps(cam.z);
+    int i = begin;
+    for (; i + 4 <= count; i += 4) {
+        __m128 s = _mm_div_ps(d, _mm_sub_ps(_mm_loadu_ps(b.z + i), cz));
+        _mm_storeu_ps(b.scale + i, s);
+        __m128 dx = _mm_sub_ps(cx, _mm_loadu_ps(b.roadX + i));
+        _mm_storeu_ps(b.X + i, _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(s, dx)), halfW));
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(b.y + i), cy);
+        _mm_storeu_ps(b.Y + i, _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(s, dy)), halfH));
+        _mm_storeu_ps(b.W + i, _mm_mul_ps(s, roadHalfW));
+    }
+    for (; i < count; i++) projectOne(b, i, cam);
+}
+
+TARGET_AVX2 static void projectAVX2(const ProjectionBatch& b, int begin, int count, const ProjectionCamera& cam)
+{
+    const __m256 one = _mm256_set1_ps(1.0f), d = _mm256_set1_ps(camD);
+    const __m256 halfW = _mm256_set1_ps(width / 2.0f), halfH = _mm256_set1_ps(height / 2.0f);
+    const __m256 roadHalfW = _mm256_set1_ps(roadW * width / 2.0f);
+    const __m256 cx = _mm256_set1_ps(cam.x), cy = _mm256_set1_ps(cam.y), cz = _mm256_set1_ps(cam.z);
+    int i = begin;
+    for (; i + 8 <= count; i += 8) {
+        __m256 s = _mm256_div_ps(d, _mm256_sub_ps(_mm256_loadu_ps(b.z + i), cz));
+        _mm256_storeu_ps(b.scale + i, s);
+        __m256 dx = _mm256_sub_ps(cx, _mm256_loadu_ps(b.roadX + i));
+        _mm256_storeu_ps(b.X + i, _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(s, dx)), halfW));
+        __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(b.y + i), cy);
+        _mm256_storeu_ps(b.Y + i, _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(s, dy)), halfH));
+        _mm256_storeu_ps(b.W + i, _mm256_mul_ps(s, roadHalfW));
+    }
+    // The tail stays in this function: calling the SSE kernel with the upper halves dirty costs more than it saves
+    for (; i < count; i++) projectOne(b, i, cam);
+    _mm256_zeroupper();
+}
+
+static bool cpuHasAVX2()
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    bool osSavesYmm = (info[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6; // OSXSAVE, XMM and YMM state
+    if (!osSavesYmm) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return false;
+#endif
+}
+#endif
+
+#ifdef PROJECTION_NEON
+static void projectNEON(const ProjectionBatch& b, int begin, int count, const ProjectionCamera& cam)
+{
+    const float32x4_t one = vdupq_n_f32(1.0f), d = vdupq_n_f32(camD);
+    const float32x4_t halfW = vdupq_n_f32(width / 2.0f), halfH = vdupq_n_f32(height / 2.0f);
+    const float32x4_t roadHalfW = vdupq_n_f32(roadW * width / 2.0f);
+    const float32x4_t cx = vdupq_n_f32(cam.x), cy = vdupq_n_f32(cam.y), cz = vdupq_n_f32(cam.z);
+    int i = begin;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t s = vdivq_f32(d, vsubq_f32(vld1q_f32(b.z + i), cz));
+        vst1q_f32(b.scale + i, s);
+        float32x4_t dx = vsubq_f32(cx, vld1q_f32(b.roadX + i));
+        vst1q_f32(b.X + i, vmulq_f32(vsubq_f32(one, vmulq_f32(s, dx)), halfW));
+        float32x4_t dy = vsubq_f32(vld1q_f32(b.y + i), cy);
+        vst1q_f32(b.Y + i, vmulq_f32(vsubq_f32(one, vmulq_f32(s, dy)), halfH));
+        vst1q_f32(b.W + i, vmulq_f32(s, roadHalfW));
+    }
+    for (; i < count; i++) projectOne(b, i, cam);
+}
+#endif
+
+static ProjectionFn kernelFunction(ProjectionKernel kernel)
+{
+    switch (kernel) {
+    case ProjectionKernel::Scalar: return projectScalar;
+#ifdef PROJECTION_X86
+    case ProjectionKernel::SSE: return projectSSE;
+    case ProjectionKernel::AVX2: return cpuHasAVX2() ? projectAVX2 : nullptr;
+#endif
+#ifdef PROJECTION_NEON
+    case ProjectionKernel::NEON: return projectNEON;
+#endif
+    default: return nullptr;
+    }
+}
+
+static ProjectionKernel bestKernel()
+{
+    const ProjectionKernel order[] = { ProjectionKernel::AVX2, ProjectionKernel::NEON, ProjectionKernel::SSE };
+    for (ProjectionKernel k : order) {
+        if (kernelFunction(k)) return k;
+    }
+    return ProjectionKernel::Scalar;
+}
+
+static ProjectionKernel currentKernel = bestKernel();
+static ProjectionFn currentFunction = kernelFunction(currentKernel);
+
+bool setProjectionKernel(ProjectionKernel kernel)
+{
+    if (kernel == ProjectionKernel::Auto) kernel = bestKernel();
+    ProjectionFn fn = kernelFunction(kernel);
+    if (!fn) return false;
+    currentKernel = kernel;
+    currentFunction = fn;
+    return true;
+}
+
+ProjectionKernel projectionKernel()
+{
+    return currentKernel;
+}
+
+const char* projectionKernelName(ProjectionKernel kernel)
+{
+    switch (kernel) {
+    case ProjectionKernel::Scalar: return "scalar";
+    case ProjectionKernel::SSE: return "sse";
+    case ProjectionKernel::AVX2: return "avx2";
+    case ProjectionKernel::NEON: return "neon";
+    default: return "auto";
+    }
+}
+
+void projectSegments(const Track& track, ProjectedTrack& proj, int first, int count, const ProjectionCamera& camera)
+{
+    ProjectionBatch b;
+    b.z = track.z + first;
+    b.y = track.y + first;
+    b.roadX = proj.roadX.data() + first;
+    b.X = proj.X.data() + first;
+    b.Y = proj.Y.data() + first;
+    b.W = proj.W.data() + first;
+    b.scale = proj.scale.data() + first;
+    currentFunction(b, 0, count, camera);
+}
+
+void projectWindow(const Track& track, ProjectedTrack& proj, int startPos, int count, float camX, float camY)
+{
+    const int n = track.size();
+    startPos %= n;
+    for (int k = 0; k < count; k++) {
+        int i = (startPos + k) % n;
+        proj.roadX[i] = track.pointFrom(startPos, startPos + k).x;
+    }
+
+    // Up to the end of the ring, then the wrapped part seen one lap further away
+    int firstSpan = count < n - startPos ? count : n - startPos;
+    ProjectionCamera camera = { camX, camY, static_cast<float>(startPos * segL) };
+    projectSegments(track, proj, startPos, firstSpan, camera);
+    if (count > firstSpan) {
+        camera.z -= static_cast<float>(n * segL);
+        projectSegments(track, proj, 0, count - firstSpan, camera);
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Track.h"
+
+#include <vector>
+
+// Screen projection of the track for the current frame, indexed like the track
+struct ProjectedTrack
+{
+    std::vector<float> X, Y, W; // screen coord
+    std::vector<float> scale;
+    std::vector<float> clip; // lowest visible screen row above this segment (hills hide sprites below it)
+    std::vector<float> roadX; // road centre relative to the camera, from the track query
+
+    void resize(int n);
+};
+
+// Camera for a batch of segments: lateral position, height and distance along the track
+struct ProjectionCamera
+{
+    float x, y, z;
+};
+
+// Implementations of the batch kernel; Auto picks the fastest one the CPU supports
+enum class ProjectionKernel { Scalar, SSE, AVX2, NEON, Auto };
+
+// Choose the kernel used by projectSegments; false if this CPU or build lacks it
+bool setProjectionKernel(ProjectionKernel kernel);
+ProjectionKernel projectionKernel();
+const char* projectionKernelName(ProjectionKernel kernel);
+
+// Project segment i for a camera at (camX, camY, camZ)
+void projectSegment(const Track& track, ProjectedTrack& proj, int i, float camX, float camY, float camZ);
+
+// Project segments first .. first + count - 1 (no wrapping) in one batch, reading proj.roadX
+void projectSegments(const Track& track, ProjectedTrack& proj, int first, int count, const ProjectionCamera& camera);
+
+// Project the draw window: count segments from the camera segment startPos, wrapping around the ring.
+// camX is the camera's lateral position and camY its height.
+void projectWindow(const Track& track, ProjectedTrack& proj, int startPos, int count, float camX, float camY);
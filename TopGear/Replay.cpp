@@ -0,0 +1,168 @@
+#include "Replay.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+static const char recordingMagic[4] = { 'T', 'G', 'I', 'R' };
+// Version 1 stored only the held controls; their edges are rebuilt on load.
+// Version 2 had no race setup.
+static const uint32_t recordingVersion = 3;
+
+static bool sameInput(const InputSnapshot& a, const InputSnapshot& b)
+{
+    return a.held == b.held && a.pressed == b.pressed && a.released == b.released;
+}
+
+void InputRecording::add(const InputSnapshot& input)
+{
+    ticks.push_back(input);
+}
+
+InputSnapshot InputRecording::get(size_t tick) const
+{
+    return tick < ticks.size() ? ticks[tick] : InputSnapshot();
+}
+
+// File layout: magic, version, sim rate, tick count, race setup (opponents, stream seed, lap length, track hash,
+// gas pickup rate, obstacle speed), then (held, pressed, released, run length) entries
+bool InputRecording::saveToFile(const std::string& filename) const
+{
+    FILE* f = std::fopen(filename.c_str(), "wb");
+    if (!f) {
+        std::cerr << "Failed to create recording: " << filename << std::endl;
+        return false;
+    }
+
+    uint32_t count = static_cast<uint32_t>(ticks.size());
+    std::fwrite(recordingMagic, 1, sizeof(recordingMagic), f);
+    std::fwrite(&recordingVersion, sizeof(recordingVersion), 1, f);
+    std::fwrite(&simRate, sizeof(simRate), 1, f);
+    std::fwrite(&count, sizeof(count), 1, f);
+    int32_t opponents = setup.opponentCount, lap = setup.lapLength;
+    uint32_t seed = setup.streamSeed;
+    std::fwrite(&opponents, sizeof(opponents), 1, f);
+    std::fwrite(&seed, sizeof(seed), 1, f);
+    std::fwrite(&lap, sizeof(lap), 1, f);
+    std::fwrite(&setup.trackHash, sizeof(setup.trackHash), 1, f);
+    std::fwrite(&setup.gasPickupRate, sizeof(setup.gasPickupRate), 1, f);
+    std::fwrite(&setup.obstacleSpeedFactor, sizeof(setup.obstacleSpeedFactor), 1, f);
+
+    size_t i = 0;
+    while (i < ticks.size()) {
+        InputSnapshot input = ticks[i];
+        uint16_t run = 0;
+        while (i < ticks.size() && sameInput(ticks[i], input) && run < 0xFFFF) {
+            run++;
+            i++;
+        }
+        unsigned char bytes[3] = { input.held, input.pressed, input.released };
+        std::fwrite(bytes, 1, sizeof(bytes), f);
+        std::fwrite(&run, sizeof(run), 1, f);
+    }
+
+    bool ok = std::ferror(f) == 0;
+    std::fclose(f);
+    if (!ok) std::cerr << "Failed to write recording: " << filename << std::endl;
+    return ok;
+}
+
+bool InputRecording::loadFromFile(const std::string& filename)
+{
+    FILE* f = std::fopen(filename.c_str(), "rb");
+    if (!f) {
+        std::cerr << "Failed to open recording: " << filename << std::endl;
+        return false;
+    }
+
+    char magic[4];
+    uint32_t version = 0, count = 0;
+    bool ok = std::fread(magic, 1, sizeof(magic), f) == sizeof(magic) && std::memcmp(magic, recordingMagic, sizeof(magic)) == 0
+        && std::fread(&version, sizeof(version), 1, f) == 1 && version >= 1 && version <= recordingVersion
+        && std::fread(&simRate, sizeof(simRate), 1, f) == 1 && simRate > 0.0f
+        && std::fread(&count, sizeof(count), 1, f) == 1;
+
+    setup = RaceSetup();
+    hasSetup = ok && version >= 3;
+    if (hasSetup) {
+        int32_t opponents = 0, lap = 0;
+        uint32_t seed = 0;
+        ok = std::fread(&opponents, sizeof(opponents), 1, f) == 1 && std::fread(&seed, sizeof(seed), 1, f) == 1
+            && std::fread(&lap, sizeof(lap), 1, f) == 1 && std::fread(&setup.trackHash, sizeof(setup.trackHash), 1, f) == 1
+            && std::fread(&setup.gasPickupRate, sizeof(setup.gasPickupRate), 1, f) == 1
+            && std::fread(&setup.obstacleSpeedFactor, sizeof(setup.obstacleSpeedFactor), 1, f) == 1;
+        setup.opponentCount = opponents;
+        setup.streamSeed = seed;
+        setup.lapLength = lap;
+    }
+
+    ticks.clear();
+    ticks.reserve(count);
+    unsigned char heldBefore = 0;
+    while (ok && ticks.size() < count) {
+        unsigned char bytes[3] = { 0, 0, 0 };
+        size_t size = version == 1 ? 1 : 3;
+        uint16_t run;
+        if (std::fread(bytes, 1, size, f) != size || std::fread(&run, sizeof(run), 1, f) != 1 || run == 0 || ticks.size() + run > count) {
+            ok = false;
+            break;
+        }
+        if (version == 1) {
+            // Only the first tick of a run can change what is held
+            ticks.push_back(InputSnapshot::fromHeld(bytes[0], heldBefore));
+            ticks.insert(ticks.end(), run - 1, InputSnapshot::fromHeld(bytes[0], bytes[0]));
+            heldBefore = bytes[0];
+        }
+        else {
+            InputSnapshot input;
+            input.held = bytes[0];
+            input.pressed = bytes[1];
+            input.released = bytes[2];
+            ticks.insert(ticks.end(), run, input);
+        }
+    }
+    std::fclose(f);
+
+    if (!ok) std::cerr << "Invalid recording: " << filename << std::endl;
+    return ok;
+}
+
+std::string raceSetupMismatch(const RaceSetup& recorded, const RaceSetup& current)
+{
+    std::ostringstream out;
+    if (recorded.opponentCount != current.opponentCount) {
+        out << "recorded with " << recorded.opponentCount << " opponents (--opponents " << recorded.opponentCount
+            << "), this race has " << current.opponentCount << "\n";
+    }
+    if (recorded.lapLength != current.lapLength || recorded.streamSeed != current.streamSeed || recorded.trackHash != current.trackHash) {
+        if (recorded.lapLength > 0) {
+            out << "recorded on a streamed track (--stream " << recorded.streamSeed << " --lap " << recorded.lapLength << ")\n";
+        }
+        else out << "recorded on another track (the built-in one without --track, or the --track file it was made with)\n";
+    }
+    if (recorded.gasPickupRate != current.gasPickupRate || recorded.obstacleSpeedFactor != current.obstacleSpeedFactor) {
+        out << "recorded with gas pickup rate " << recorded.gasPickupRate << " and obstacle speed " << recorded.obstacleSpeedFactor
+            << ", this race has " << current.gasPickupRate << " and " << current.obstacleSpeedFactor << "\n";
+    }
+    return out.str();
+}
+
+void printFrameTimes(std::vector<float>& frameMs, double totalSeconds)
+{
+    if (frameMs.empty()) {
+        std::printf("No frames recorded.\n");
+        return;
+    }
+
+    std::sort(frameMs.begin(), frameMs.end());
+    double sum = 0.0;
+    for (float ms : frameMs) sum += ms;
+    auto percentile = [&](int p) { return frameMs[std::min(frameMs.size() - 1, frameMs.size() * p / 100)]; };
+
+    std::printf("Frames: %zu, total wall time: %.3f s (%.1f FPS)\n", frameMs.size(), totalSeconds, frameMs.size() / totalSeconds);
+    std::printf("Frame time ms: mean %.3f, p50 %.3f, p95 %.3f, p99 %.3f, max %.3f\n",
+        sum / frameMs.size(), percentile(50), percentile(95), percentile(99), frameMs.back());
+}
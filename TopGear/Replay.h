@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Input.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Everything besides the inputs that decides how a race goes: a recording replays as recorded only under the same setup
+struct RaceSetup
+{
+    int opponentCount = 0;
+    unsigned streamSeed = 0;
+    int lapLength = 0; // Segments per lap of a streamed track, 0 for a looping one
+    uint64_t trackHash = 0; // Segments of a looping track (Track::fingerprint), 0 for a streamed one
+    float gasPickupRate = 0.0f;
+    float obstacleSpeedFactor = 0.0f;
+};
+
+// Controls of every simulation tick of a race, for deterministic replays and benchmarks.
+// Saved as a small header followed by run-length encoded ticks.
+struct InputRecording
+{
+    float simRate = 0.0f; // Ticks per second the inputs were recorded at
+    std::vector<InputSnapshot> ticks; // The snapshot the simulation read at every tick
+    RaceSetup setup; // Saved with the ticks
+    bool hasSetup = false; // Set by loadFromFile; recordings before version 3 do not store it
+
+    void add(const InputSnapshot& input);
+    InputSnapshot get(size_t tick) const; // No input past the end
+
+    bool saveToFile(const std::string& filename) const;
+    bool loadFromFile(const std::string& filename);
+};
+
+// What differs between the setup of a recording and the race it would replay in, one line per option; empty if nothing does
+std::string raceSetupMismatch(const RaceSetup& recorded, const RaceSetup& current);
+
+// Print mean, p50, p95, p99 and max of the frame times (sorts frameMs)
+void printFrameTimes(std::vector<float>& frameMs, double totalSeconds);
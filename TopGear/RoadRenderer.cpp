@@ -0,0 +1,39 @@
+#include "RoadRenderer.h"
+
+using namespace sf;
+
+RoadRenderer::RoadRenderer()
+    : vertices(Triangles)
+{
+}
+
+void RoadRenderer::begin()
+{
+    vertices.clear();
+}
+
+// Same corners as the old ConvexShape path, split into two triangles.
+// A convex quad covers the same pixels whatever the triangulation, so the output is identical.
+void RoadRenderer::addQuad(Color c, int x1, int y1, int w1, int x2, int y2, int w2)
+{
+    Vertex p0(Vector2f(static_cast<float>(x1 - w1), static_cast<float>(y1)), c);
+    Vertex p1(Vector2f(static_cast<float>(x2 - w2), static_cast<float>(y2)), c);
+    Vertex p2(Vector2f(static_cast<float>(x2 + w2), static_cast<float>(y2)), c);
+    Vertex p3(Vector2f(static_cast<float>(x1 + w1), static_cast<float>(y1)), c);
+
+    vertices.append(p0);
+    vertices.append(p1);
+    vertices.append(p2);
+    vertices.append(p0);
+    vertices.append(p2);
+    vertices.append(p3);
+}
+
+void RoadRenderer::flush(RenderTarget& target, RenderStats& stats)
+{
+    if (vertices.getVertexCount() == 0) return;
+
+    target.draw(vertices);
+    stats.drawCalls++;
+    stats.vertices += static_cast<unsigned>(vertices.getVertexCount());
+}
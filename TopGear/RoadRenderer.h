@@ -0,0 +1,28 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+
+// Draw calls and vertices submitted during a frame
+struct RenderStats
+{
+    unsigned drawCalls = 0;
+    unsigned vertices = 0;
+    // Calls of the sprite pass, and what it would take drawing the sprites in plain depth order
+    unsigned spriteCalls = 0;
+    unsigned spriteCallsDepthOrder = 0;
+
+    void reset() { drawCalls = vertices = spriteCalls = spriteCallsDepthOrder = 0; }
+};
+
+// Collects every road quad of a frame into one vertex array and draws it in a single call.
+// The array is kept between frames so its storage is only allocated once.
+struct RoadRenderer
+{
+    sf::VertexArray vertices;
+
+    RoadRenderer();
+
+    void begin();
+    void addQuad(sf::Color c, int x1, int y1, int w1, int x2, int y2, int w2);
+    void flush(sf::RenderTarget& target, RenderStats& stats);
+};
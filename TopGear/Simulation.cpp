@@ -0,0 +1,339 @@
+#include "Simulation.h"
+#include "GameConstants.h"
+#include "Log.h"
+#include "Profiler.h"
+#include "TrackStream.h"
+
+#include <algorithm>
+#include <cmath>
+
+const float contactRestitution = 0.5f; // Part of the closing speed two cars keep, apart, after they touch
+
+Simulation::Simulation(const Track& t, int count)
+    : track(t), opponentCount(count)
+{
+    reset();
+}
+
+void Simulation::reset()
+{
+    const int n = track.size();
+
+    player = Player();
+    player.pos = (n - 20) * segL; // Inicia o carro 20 segmentos antes da linha de chegada
+
+    // Adversários mais próximos da linha de chegada: em fila, alternando os lados, os mais rápidos à frente.
+    // Com dois carros: -0.8 a 200 e 0.8 a 220, 4 e 2 segmentos antes da linha
+    opponents.clear();
+    float spacing = std::min(2.0f * segL, static_cast<float>(n / 2 * segL) / std::max(opponentCount, 1));
+    for (int k = 0; k < opponentCount; k++) {
+        int behind = opponentCount - 1 - k;
+        float startPos = static_cast<float>((n - 2) * segL) - spacing * behind;
+        float speed = 180.0f + 40.0f * (k + 1) / opponentCount;
+        opponents.add(startPos, behind % 2 == 0 ? 0.8f : -0.8f, speed);
+    }
+
+    const double trackLength = static_cast<double>(n) * segL;
+    standings.reset(opponentCount + 1, trackLength);
+    traffic.reset(opponentCount + 1, trackLength, !track.isStreamed(), carReach * segL - carLength);
+    track.follow(0, player.pos / segL);
+    collisions.reset(track);
+    player.swept = track.distance(0, player.pos / segL) + carReach;
+
+    raceStarted = false;
+    lastStartPos = n - 20;
+    raceTime = 0.0f;
+    backgroundX = 0.0f;
+
+    // Grid order, so the cars find each other from the first tick
+    updateRankings();
+    updateTraffic();
+    playerPosition = 1;
+}
+
+RaceSetup Simulation::setup() const
+{
+    RaceSetup s;
+    s.opponentCount = opponentCount;
+    if (const TrackStream* stream = track.streamer()) {
+        s.streamSeed = stream->generator.seed;
+        s.lapLength = stream->generator.lapLength;
+    }
+    s.trackHash = track.fingerprint();
+    s.gasPickupRate = gasPickupRate;
+    s.obstacleSpeedFactor = obstacleSpeedFactor;
+    return s;
+}
+
+void Simulation::step(const InputSnapshot& input, float elapsedSeconds)
+{
+    // Iniciar corrida na primeira pressão de W
+    if (input.isHeld(Control::Accelerate) && !raceStarted) {
+        raceStarted = true;
+        LOG_INFO(LogCategory::Race, "Race Started!");
+    }
+    if (raceStarted && !player.finished) raceTime += elapsedSeconds;
+
+    // Atualizar adversários
+    {
+        PROFILE_SCOPE(ProfilePhase::OpponentUpdate);
+        opponents.update(elapsedSeconds, track, raceStarted, standings, traffic);
+    }
+
+    {
+        PROFILE_SCOPE(ProfilePhase::PlayerPhysics);
+        updatePlayer(input, elapsedSeconds);
+        track.follow(player.laps, player.pos / segL);
+    }
+
+    {
+        PROFILE_SCOPE(ProfilePhase::Ranking);
+        updateRankings();
+    }
+
+    {
+        PROFILE_SCOPE(ProfilePhase::Traffic);
+        updateTraffic();
+    }
+}
+
+void Simulation::updatePlayer(const InputSnapshot& input, float elapsedSeconds)
+{
+    const int n = track.size();
+    const int trackLength = n * segL;
+    Player& p = player;
+
+    const float xBefore = p.x;
+
+    // Get the current segment's curve
+    int currentSegment = p.pos / segL;
+    float currentCurve = track.curve[currentSegment % n];
+
+    // Curve influence on playerX
+    float curveInfluence = currentCurve * elapsedSeconds * (p.speed / 200.0f);
+    p.x += curveInfluence;
+
+    // Steering input (A: move left, D: move right)
+    float steeringForce = 0.6f;
+    p.steer = 0;
+    if (p.speed >= 50) {
+        if (input.isHeld(Control::Left)) {
+            p.x -= steeringForce * elapsedSeconds;
+            p.steer = -1;
+        }
+        else if (input.isHeld(Control::Right)) {
+            p.x += steeringForce * elapsedSeconds;
+            p.steer = 1;
+        }
+    }
+
+    // Verificar se o carro está na grama
+    p.onGrass = (std::abs(p.x * roadW) > roadW / 2.0f * 1.2f);
+    if (p.onGrass) {
+        LOG_DEBUG_EVERY(0.5, LogCategory::Player, "On Grass! Speed: %g km/h, Gear: %d, Gas: %g", p.speed / 3, p.gear, p.gas);
+        p.speed -= 0.3f * elapsedSeconds;
+        if (p.speed < 0) p.speed = 0;
+    }
+
+    // Aceleração
+    if (input.isHeld(Control::Accelerate) && p.gas > 0 && !p.finished) {
+        float currentAcceleration = p.onGrass ? gearAcceleration[p.gear] * 0.8f : gearAcceleration[p.gear];
+        p.speed += currentAcceleration * elapsedSeconds;
+        float currentMaxSpeed = p.onGrass ? gearMaxSpeed[p.gear] * 0.8f : gearMaxSpeed[p.gear];
+        if (p.speed > currentMaxSpeed) p.speed = currentMaxSpeed;
+        LOG_DEBUG_EVERY(0.5, LogCategory::Player, "Accelerating! Speed: %g km/h, Gear: %d, Gas: %g", p.speed / 3, p.gear, p.gas);
+    }
+    else {
+        p.speed -= 0.5f * elapsedSeconds;
+        if (p.speed < 0) p.speed = 0;
+    }
+
+    // Limit playerX
+    if (p.x > maxPlayerX) p.x = maxPlayerX;
+    if (p.x < -maxPlayerX) p.x = -maxPlayerX;
+
+    // Mudança de marchas
+    if (input.isHeld(Control::ShiftUp)) {
+        if (p.gear < maxGear && static_cast<int>(p.speed) >= gearMaxSpeed[p.gear] * 0.8f) {
+            p.gear++;
+            float currentMaxSpeed = p.onGrass ? gearMaxSpeed[p.gear] * 0.8f : gearMaxSpeed[p.gear];
+            if (p.speed > currentMaxSpeed) p.speed = currentMaxSpeed;
+            LOG_INFO(LogCategory::Player, "Upshifted to Gear: %d", p.gear);
+        }
+    }
+    // Reduzir uma marcha por toque na tecla
+    if (input.wasPressed(Control::ShiftDown) && p.gear > 1) {
+        p.gear--;
+        LOG_INFO(LogCategory::Player, "Downshifted to Gear: %d", p.gear);
+    }
+
+    // Atualizar posição do jogador
+    int lapsBefore = track.lapsDone(p.laps, lastStartPos);
+    if (!p.finished) {
+        float move = p.speed * elapsedSeconds * 125.0f + p.posFraction;
+        int units = static_cast<int>(move);
+        p.posFraction = move - units;
+        p.pos += units;
+        while (p.pos >= trackLength) {
+            p.pos -= trackLength;
+            p.laps++;
+        }
+        while (p.pos < 0) p.pos += trackLength;
+        // Numa pista gerada a chegada não coincide com o fim do anel
+        if (track.distance(p.laps, p.pos / segL) >= track.finishDistance(TOTAL_LAPS)) {
+            p.finished = true;
+            LOG_INFO(LogCategory::Race, "Player finished race!");
+        }
+    }
+
+    // Contagem de voltas
+    int startPos = p.pos / segL;
+    if (track.lapsDone(p.laps, startPos) > lapsBefore) {
+        LOG_INFO(LogCategory::Race, "Lap completed! Total laps: %d", track.lapsDone(p.laps, startPos));
+    }
+    lastStartPos = startPos;
+
+    // Fundo acompanha a curva
+    if (p.speed > 0) backgroundX -= track.curve[startPos] * 2.f * elapsedSeconds * 5.0f;
+    if (p.speed < 0) backgroundX += track.curve[startPos] * 2.f * elapsedSeconds * 5.0f;
+
+    // Consumo de combustível
+    if (p.speed > 0 && p.gas > 0) {
+        p.gas -= ((p.speed / 20.0f) * elapsedSeconds / 6.f) * static_cast<float>(p.gear);
+        if (p.gas < 0) p.gas = 0;
+    }
+    if (p.gas <= 0) {
+        p.speed -= 0.5f * elapsedSeconds;
+        if (p.speed < 0) p.speed = 0;
+        LOG_DEBUG_EVERY(1.0, LogCategory::Player, "Out of Gas!");
+    }
+
+    // Combustível e cenário nos segmentos que a frente do carro cruzou neste tick.
+    // Cada segmento é varrido uma só vez, então cada posto dá combustível uma vez por passagem.
+    long long front = track.distance(p.laps, startPos) + carReach;
+    if (front > p.swept) {
+        hits.clear();
+        float left = std::min(xBefore, p.x) - carHalfWidth, right = std::max(xBefore, p.x) + carHalfWidth;
+        collisions.sweep(track, p.swept, front, left, right, hits);
+        p.swept = front;
+        const CollisionHit* obstacle = nullptr;
+        for (const CollisionHit& hit : hits) {
+            if (hit.item.kind == CollidableKind::Pickup) {
+                // Time the front of the car takes to cross the reach at this speed
+                p.gas += gasPickupRate * carReach * segL / (std::max(p.speed, 1.0f) * 125.0f);
+                LOG_DEBUG(LogCategory::Player, "Collected Gas! Gas: %g", p.gas);
+            }
+            else if (!obstacle) obstacle = &hit;
+        }
+        // Grazing two trunks in one tick is still one crash
+        if (obstacle) {
+            p.speed *= obstacleSpeedFactor;
+            LOG_INFO(LogCategory::Player, "Hit scenery at segment %lld, speed: %g", obstacle->segment, p.speed);
+        }
+    }
+}
+
+void Simulation::updateRankings()
+{
+    // Calcular posição na corrida
+    standings.setProgress(0, player.laps, player.pos);
+    for (int i = 0; i < opponents.size(); i++) {
+        standings.setProgress(i + 1, opponents.laps[i], opponents.pos[i]);
+    }
+    standings.update();
+    playerPosition = standings.rankOf(0);
+
+    for (const OvertakeEvent& e : standings.overtakes()) {
+        if (e.car == 0) LOG_INFO(LogCategory::Race, "Overtook opponent %d, now position %d", e.passed - 1, e.rank);
+        else if (e.passed == 0) LOG_INFO(LogCategory::Race, "Overtaken by opponent %d, now position %d", e.car - 1, e.rank + 1);
+    }
+}
+
+void Simulation::updateTraffic()
+{
+    // Carros só se tocam com a corrida em andamento; os que terminaram saem da pista
+    traffic.x[0] = player.x;
+    traffic.speed[0] = player.speed;
+    traffic.racing[0] = raceStarted && !player.finished;
+    for (int i = 0; i < opponents.size(); i++) {
+        traffic.x[i + 1] = opponents.x[i];
+        traffic.speed[i + 1] = opponents.speed[i];
+        traffic.racing[i + 1] = raceStarted && !opponents.finished[i];
+    }
+    if (!raceStarted) return;
+
+    contacts.clear();
+    traffic.findContacts(standings, contacts);
+    for (const CarContact& c : contacts) {
+        // A car running into another gives it part of its speed, like two equal masses bumping:
+        // the sum stays the same and they separate. Then both are pushed apart sideways.
+        float& behindSpeed = c.behind == 0 ? player.speed : opponents.speed[c.behind - 1];
+        float& aheadSpeed = c.ahead == 0 ? player.speed : opponents.speed[c.ahead - 1];
+        float closing = behindSpeed - aheadSpeed;
+        if (closing > 0.0f) {
+            float exchange = closing * (1.0f + contactRestitution) * 0.5f;
+            behindSpeed -= exchange;
+            aheadSpeed += exchange;
+            traffic.speed[c.behind] = behindSpeed;
+            traffic.speed[c.ahead] = aheadSpeed;
+        }
+
+        float dx = traffic.x[c.behind] - traffic.x[c.ahead];
+        float side = dx > 0.0f ? 1.0f : dx < 0.0f ? -1.0f : (traffic.x[c.ahead] > 0.0f ? -1.0f : 1.0f);
+        float push = (2.0f * carHalfWidth - std::abs(dx)) * 0.5f;
+        for (int car : { c.behind, c.ahead }) {
+            float limit = car == 0 ? maxPlayerX : maxOpponentX;
+            float& x = car == 0 ? player.x : opponents.x[car - 1];
+            x = std::max(-limit, std::min(limit, x + (car == c.behind ? side : -side) * push));
+            traffic.x[car] = x;
+        }
+
+        if (c.behind == 0) LOG_INFO_EVERY(1.0, LogCategory::Race, "Ran into opponent %d", c.ahead - 1);
+        else if (c.ahead == 0) LOG_INFO_EVERY(1.0, LogCategory::Race, "Hit by opponent %d", c.behind - 1);
+    }
+}
+
+void captureRenderState(const Simulation& sim, RenderState& out)
+{
+    out.player.pos = static_cast<float>(sim.player.pos) + sim.player.posFraction;
+    out.player.x = sim.player.x;
+    out.player.wraps = sim.player.laps;
+    out.opponents.resize(sim.opponents.size());
+    for (int i = 0; i < sim.opponents.size(); i++) {
+        out.opponents[i].pos = sim.opponents.pos[i];
+        out.opponents[i].x = sim.opponents.x[i];
+        out.opponents[i].wraps = sim.opponents.laps[i];
+    }
+    out.backgroundX = sim.backgroundX;
+}
+
+static float lerp(float a, float b, float t)
+{
+    return a + (b - a) * t;
+}
+
+static CarPose interpolatePose(const CarPose& a, const CarPose& b, float alpha, float trackLength)
+{
+    CarPose r;
+    float to = b.pos;
+    if (to < a.pos - trackLength / 2.0f) to += trackLength;
+    r.pos = lerp(a.pos, to, alpha);
+    r.wraps = a.wraps;
+    if (r.pos >= trackLength) {
+        r.pos -= trackLength;
+        r.wraps++;
+    }
+    r.x = lerp(a.x, b.x, alpha);
+    return r;
+}
+
+void interpolateRenderState(const RenderState& prev, const RenderState& curr, float alpha, float trackLength, RenderState& out)
+{
+    out.player = interpolatePose(prev.player, curr.player, alpha, trackLength);
+    out.opponents.resize(curr.opponents.size());
+    for (size_t i = 0; i < curr.opponents.size(); i++) {
+        if (i < prev.opponents.size()) out.opponents[i] = interpolatePose(prev.opponents[i], curr.opponents[i], alpha, trackLength);
+        else out.opponents[i] = curr.opponents[i];
+    }
+    out.backgroundX = lerp(prev.backgroundX, curr.backgroundX, alpha);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "CollisionIndex.h"
+#include "Input.h"
+#include "OpponentField.h"
+#include "Replay.h"
+#include "Standings.h"
+#include "Track.h"
+#include "Traffic.h"
+
+#include <vector>
+
+// The player car covers the segments 1..9 ahead of the camera on screen;
+// collidables are checked when its front reaches them
+const int carReach = 9;
+const float maxPlayerX = 2.0f;
+
+// Player car state
+struct Player
+{
+    float x = 0.0f; // Lateral position
+    int pos = 0; // Position along track
+    float posFraction = 0.0f; // Part of a unit moved but not yet in pos, so the tick rate does not change the speed
+    float speed = 0.0f;
+    int laps = 0;
+    float gas = 100.0f;
+    int gear = 1;
+    bool finished = false;
+    bool onGrass = false;
+    int steer = 0; // -1 turning left, 1 turning right
+    long long swept = 0; // Farthest segment checked for collidables, as Track::distance
+};
+
+// Race logic without any window, input device or clock: driven by input snapshots and a timestep
+struct Simulation
+{
+    const Track& track;
+    Player player;
+    OpponentField opponents;
+    int opponentCount = 2; // Cars placed on the grid by reset()
+    RaceStandings standings; // Car 0 is the player, car i + 1 is opponent i
+    bool raceStarted = false;
+    int playerPosition = 1;
+    int lastStartPos = 0;
+    float raceTime = 0.0f; // Seconds since the race started
+    float backgroundX = 0.0f; // Parallax offset of the sky, in pixels
+    CollisionIndex collisions; // Fuel pickups and scenery the player can touch
+    Traffic traffic; // Where the cars are on the road, for contacts and overtaking
+
+    // Game balance of the collidables, as before the collidable index. A station gave +2 every 120 Hz tick
+    // while in reach; it now gives once per pass what that came to at the speed of the pass.
+    float gasPickupRate = 240.0f; // Gas per second spent in reach of a station
+    float obstacleSpeedFactor = 1.0f; // Speed kept after running into a trunk, once per tick; 1: scenery does not slow the car
+
+    explicit Simulation(const Track& t, int opponentCount = 2);
+
+    void reset();
+    void step(const InputSnapshot& input, float elapsedSeconds);
+    bool isRaceOver() const { return player.finished; }
+    RaceSetup setup() const; // For recordings, which replay only in a race set up the same way
+    void updateRankings(); // Part of step(), public for benchmarks
+    void updateTraffic(); // Part of step(), after updateRankings; public for benchmarks
+
+private:
+    std::vector<CollisionHit> hits; // Reused every tick
+    std::vector<CarContact> contacts;
+
+    void updatePlayer(const InputSnapshot& input, float elapsedSeconds);
+};
+
+// Car position used for drawing
+struct CarPose
+{
+    float pos = 0.0f; // Position along track
+    float x = 0.0f; // Lateral position
+    int wraps = 0; // Passes over the track arrays, like Player::laps: on a streamed track pos alone does not say where the car is
+};
+
+// Everything drawing needs to place the cars, captured after every tick
+struct RenderState
+{
+    CarPose player;
+    std::vector<CarPose> opponents;
+    float backgroundX = 0.0f;
+};
+
+void captureRenderState(const Simulation& sim, RenderState& out);
+
+// Blend two consecutive ticks; positions that wrapped past the finish line are unwrapped first
+void interpolateRenderState(const RenderState& prev, const RenderState& curr, float alpha, float trackLength, RenderState& out);
+
+// Upper speed and acceleration per gear
+const int maxGear = 5;
+const float gearMaxSpeed[] = { 0, 30 * 3, 60 * 3, 90 * 3, 110 * 3, 133 * 3 };
+const float gearAcceleration[] = { 0, 12.0f, 10.0f, 7.0f, 5.0f, 3.0f };
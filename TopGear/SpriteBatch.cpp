@@ -0,0 +1,53 @@
+#include "SpriteBatch.h"
+
+using namespace sf;
+
+SpriteBatch::SpriteBatch()
+    : vertices(Triangles)
+{
+}
+
+void SpriteBatch::begin(const Texture& tex)
+{
+    texture = &tex;
+    vertices.clear();
+}
+
+void SpriteBatch::use(const Texture& tex, RenderTarget& target, RenderStats& stats)
+{
+    if (&tex == texture) return;
+    flush(target, stats);
+    texture = &tex;
+}
+
+void SpriteBatch::addSprite(const IntRect& rect, float x, float y, float scaleX, float scaleY)
+{
+    float right = x + static_cast<float>(rect.width) * scaleX;
+    float bottom = y + static_cast<float>(rect.height) * scaleY;
+    float u0 = static_cast<float>(rect.left);
+    float v0 = static_cast<float>(rect.top);
+    float u1 = static_cast<float>(rect.left + rect.width);
+    float v1 = static_cast<float>(rect.top + rect.height);
+
+    Vertex topLeft(Vector2f(x, y), Vector2f(u0, v0));
+    Vertex topRight(Vector2f(right, y), Vector2f(u1, v0));
+    Vertex bottomRight(Vector2f(right, bottom), Vector2f(u1, v1));
+    Vertex bottomLeft(Vector2f(x, bottom), Vector2f(u0, v1));
+
+    vertices.append(topLeft);
+    vertices.append(bottomLeft);
+    vertices.append(bottomRight);
+    vertices.append(topLeft);
+    vertices.append(bottomRight);
+    vertices.append(topRight);
+}
+
+void SpriteBatch::flush(RenderTarget& target, RenderStats& stats)
+{
+    if (vertices.getVertexCount() == 0) return;
+
+    target.draw(vertices, texture);
+    stats.drawCalls++;
+    stats.vertices += static_cast<unsigned>(vertices.getVertexCount());
+    vertices.clear();
+}
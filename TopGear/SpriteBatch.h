@@ -0,0 +1,22 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+
+#include "RoadRenderer.h"
+
+// Collects textured quads and draws each run of quads from the same texture in a single call.
+// Quads are drawn in the order they are added.
+struct SpriteBatch
+{
+    sf::VertexArray vertices;
+    const sf::Texture* texture = nullptr;
+
+    SpriteBatch();
+
+    void begin(const sf::Texture& tex);
+    // Quads added next come from tex; a different texture draws the quads collected so far first
+    void use(const sf::Texture& tex, sf::RenderTarget& target, RenderStats& stats);
+    // Same placement as an sf::Sprite with this texture rect, position and scale
+    void addSprite(const sf::IntRect& rect, float x, float y, float scaleX, float scaleY);
+    void flush(sf::RenderTarget& target, RenderStats& stats);
+};
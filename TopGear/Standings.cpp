@@ -0,0 +1,48 @@
+#include "Standings.h"
+
+#include <algorithm>
+
+void RaceStandings::reset(int carCount, double length)
+{
+    lapLength = length;
+    laps.assign(carCount, 0);
+    pos.assign(carCount, 0.0);
+    order.resize(carCount);
+    rank.resize(carCount);
+    for (int i = 0; i < carCount; i++) {
+        order[i] = carCount - 1 - i; // Equal progress: higher index first
+        rank[order[i]] = i;
+    }
+    events.clear();
+    events.reserve(std::max(64, carCount * 4));
+    dropped = 0;
+}
+
+void RaceStandings::update()
+{
+    events.clear();
+    dropped = 0;
+
+    // Insertion sort: linear when nothing changed, one swap per overtake otherwise
+    const int n = carCount();
+    for (int r = 1; r < n; r++) {
+        int car = order[r];
+        int j = r;
+        while (j > 0 && ahead(car, order[j - 1])) {
+            int passed = order[j - 1];
+            order[j] = passed;
+            rank[passed] = j;
+            j--;
+            if (events.size() < events.capacity()) events.push_back({ car, passed, j + 1 });
+            else dropped++;
+        }
+        order[j] = car;
+        rank[car] = j;
+    }
+}
+
+int RaceStandings::countAhead(double distance) const
+{
+    auto first = std::partition_point(order.begin(), order.end(), [&](int car) { return distanceOf(car) > distance; });
+    return static_cast<int>(first - order.begin());
+}
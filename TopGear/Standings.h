@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+
+// One car passing another during a tick
+struct OvertakeEvent
+{
+    int car; // Car that moved up
+    int passed; // Car it passed
+    int rank; // New rank of car, 1 = leader
+};
+
+// Race order kept between ticks. Cars are ordered by exact progress (laps, then position
+// on the lap); as the order barely changes from one tick to the next it is repaired with
+// adjacent swaps, one per overtake. All storage is allocated by reset().
+// The order is also the order along the road, which makes it the broadphase for car contacts (Traffic).
+struct RaceStandings
+{
+    void reset(int carCount, double lapLength);
+
+    // Progress of a car this tick
+    void setProgress(int car, int laps, double pos)
+    {
+        this->laps[car] = laps;
+        this->pos[car] = pos;
+    }
+
+    // Restore the order after setProgress and record the overtakes
+    void update();
+
+    int carCount() const { return static_cast<int>(order.size()); }
+    int rankOf(int car) const { return rank[car] + 1; } // 1 = leader
+    int carAt(int rankNumber) const { return order[rankNumber - 1]; }
+
+    // Race distance of a car, laps * lap length + position: the standings are sorted by it
+    double distanceOf(int car) const { return laps[car] * lapLength + pos[car]; }
+    // Number of cars farther than race distance `distance`, by binary search
+    int countAhead(double distance) const;
+
+    // Overtakes of the last update, in the order they were resolved
+    const std::vector<OvertakeEvent>& overtakes() const { return events; }
+    int droppedOvertakes() const { return dropped; } // Events beyond the buffer in the last update
+
+private:
+    double lapLength = 0.0;
+    std::vector<int> laps;
+    std::vector<double> pos;
+    std::vector<int> order; // Car at each rank
+    std::vector<int> rank; // Rank of each car, from 0
+    std::vector<OvertakeEvent> events;
+    int dropped = 0;
+
+    // Ties go to the higher car index, like the sort this replaced
+    bool ahead(int a, int b) const
+    {
+        if (laps[a] != laps[b]) return laps[a] > laps[b];
+        if (pos[a] != pos[b]) return pos[a] > pos[b];
+        return a > b;
+    }
+};
@@ -0,0 +1,56 @@
+#include "TextureAtlas.h"
+
+#include <algorithm>
+#include <iostream>
+
+using namespace sf;
+
+// Transparent gap between images so smoothing does not bleed into the neighbours
+const unsigned atlasPadding = 2;
+
+bool TextureAtlas::pack(const std::vector<std::string>& names, const std::vector<const Image*>& images, Image& atlas)
+{
+    // Shelf packing, tallest images first
+    std::vector<size_t> order(names.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return images[a]->getSize().y > images[b]->getSize().y;
+    });
+
+    const unsigned atlasWidth = std::min(4096u, Texture::getMaximumSize());
+    unsigned x = 0, y = 0, shelfHeight = 0;
+    rects.clear();
+    for (size_t i : order) {
+        Vector2u size = images[i]->getSize();
+        if (size.x + atlasPadding > atlasWidth) {
+            std::cerr << "Image too wide for the texture atlas: " << names[i] << std::endl;
+            return false;
+        }
+        if (x + size.x + atlasPadding > atlasWidth) {
+            x = 0;
+            y += shelfHeight;
+            shelfHeight = 0;
+        }
+        rects[names[i]] = IntRect(static_cast<int>(x), static_cast<int>(y), static_cast<int>(size.x), static_cast<int>(size.y));
+        x += size.x + atlasPadding;
+        shelfHeight = std::max(shelfHeight, size.y + atlasPadding);
+    }
+    unsigned atlasHeight = y + shelfHeight;
+    if (atlasHeight > Texture::getMaximumSize()) {
+        std::cerr << "Texture atlas too large: " << atlasWidth << "x" << atlasHeight << std::endl;
+        return false;
+    }
+
+    atlas.create(atlasWidth, atlasHeight, Color::Transparent);
+    for (size_t i = 0; i < names.size(); i++) {
+        const IntRect& r = rects[names[i]];
+        atlas.copy(*images[i], static_cast<unsigned>(r.left), static_cast<unsigned>(r.top));
+    }
+    return true;
+}
+
+IntRect TextureAtlas::get(const std::string& name) const
+{
+    auto it = rects.find(name);
+    return it != rects.end() ? it->second : IntRect();
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "TextureCache.h"
+
+#include <SFML/Graphics.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Several images packed into one texture at load time, so their sprites can share a draw call
+struct TextureAtlas
+{
+    TextureHandle texture;
+    std::map<std::string, sf::IntRect> rects; // image name -> pixel rect inside the texture
+
+    // Lay the images out and compose the atlas image; the texture is created from it by the texture cache
+    bool pack(const std::vector<std::string>& names, const std::vector<const sf::Image*>& images, sf::Image& atlas);
+
+    // Rect of a packed image (empty rect if the name is unknown)
+    sf::IntRect get(const std::string& name) const;
+};
@@ -0,0 +1,127 @@
+#include "TextureCache.h"
+#include "Log.h"
+
+#include <iostream>
+
+TextureHandle::TextureHandle(TextureCache* owner, void* cached)
+    : cache(owner), entry(cached)
+{
+    cache->addRef(static_cast<TextureCache::Entry*>(entry));
+}
+
+TextureHandle::TextureHandle(const TextureHandle& other)
+    : cache(other.cache), entry(other.entry)
+{
+    if (entry) cache->addRef(static_cast<TextureCache::Entry*>(entry));
+}
+
+TextureHandle& TextureHandle::operator=(const TextureHandle& other)
+{
+    if (this == &other) return *this;
+    // Referência nova antes de soltar a antiga, caso sejam a mesma textura
+    if (other.entry) other.cache->addRef(static_cast<TextureCache::Entry*>(other.entry));
+    reset();
+    cache = other.cache;
+    entry = other.entry;
+    return *this;
+}
+
+TextureHandle::~TextureHandle()
+{
+    reset();
+}
+
+const sf::Texture& TextureHandle::operator*() const
+{
+    return static_cast<TextureCache::Entry*>(entry)->texture;
+}
+
+void TextureHandle::reset()
+{
+    if (entry) cache->release(static_cast<TextureCache::Entry*>(entry));
+    cache = nullptr;
+    entry = nullptr;
+}
+
+TextureCache::TextureCache(Loader load, size_t budget)
+    : loader(std::move(load)), budgetBytes(budget)
+{
+}
+
+TextureCache::~TextureCache()
+{
+    for (const auto& it : entries) {
+        if (it.second->refs > 0) std::cerr << "Texture still in use when the cache was destroyed: " << it.first << std::endl;
+    }
+}
+
+size_t TextureCache::textureBytes(const sf::Texture& texture)
+{
+    sf::Vector2u size = texture.getSize();
+    return static_cast<size_t>(size.x) * size.y * 4;
+}
+
+TextureHandle TextureCache::acquire(const std::string& name)
+{
+    auto it = entries.find(name);
+    if (it != entries.end()) {
+        hitCount++;
+        return TextureHandle(this, it->second.get());
+    }
+
+    std::unique_ptr<Entry> entry(new Entry());
+    entry->name = name;
+    if (!loader(name, entry->texture)) return TextureHandle();
+    entry->bytes = textureBytes(entry->texture);
+    usedBytes += entry->bytes;
+    loadCount++;
+    LOG_DEBUG(LogCategory::Assets, "Texture %s loaded: %u KiB, %u KiB cached", name.c_str(),
+        static_cast<unsigned>(entry->bytes >> 10), static_cast<unsigned>(usedBytes >> 10));
+
+    Entry* cached = entry.get();
+    entries.emplace(name, std::move(entry));
+    // Criada já com uma referência, para não ser ela a primeira despejada
+    TextureHandle handle(this, cached);
+    trim();
+    return handle;
+}
+
+void TextureCache::setBudget(size_t bytes)
+{
+    budgetBytes = bytes;
+    trim();
+}
+
+void TextureCache::addRef(Entry* entry)
+{
+    if (entry->refs++ == 0 && entry->isIdle) {
+        idle.erase(entry->idlePos);
+        entry->isIdle = false;
+    }
+}
+
+void TextureCache::release(Entry* entry)
+{
+    if (--entry->refs > 0) return;
+    idle.push_front(entry);
+    entry->idlePos = idle.begin();
+    entry->isIdle = true;
+    trim();
+}
+
+void TextureCache::trim()
+{
+    // Só texturas sem handles podem sair; as em uso ficam mesmo acima do orçamento
+    while (usedBytes > budgetBytes && !idle.empty()) {
+        Entry* entry = idle.back();
+        idle.pop_back();
+        usedBytes -= entry->bytes;
+        evictionCount++;
+        LOG_DEBUG(LogCategory::Assets, "Texture %s evicted: %u KiB cached", entry->name.c_str(), static_cast<unsigned>(usedBytes >> 10));
+        entries.erase(entries.find(entry->name));
+    }
+    if (usedBytes > budgetBytes) {
+        LOG_AT_EVERY(5.0, LogLevel::Warn, LogCategory::Assets, "Textures in use take %u KiB, over the %u KiB budget",
+            static_cast<unsigned>(usedBytes >> 10), static_cast<unsigned>(budgetBytes >> 10));
+    }
+}
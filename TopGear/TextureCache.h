@@ -0,0 +1,84 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+struct TextureCache;
+
+// Shared reference to a cached texture; the texture stays loaded while any handle to it exists
+struct TextureHandle
+{
+    TextureHandle() = default;
+    TextureHandle(const TextureHandle& other);
+    TextureHandle& operator=(const TextureHandle& other);
+    ~TextureHandle();
+
+    explicit operator bool() const { return entry != nullptr; }
+    const sf::Texture& operator*() const;
+    const sf::Texture* operator->() const { return &**this; }
+    void reset();
+
+private:
+    friend struct TextureCache;
+    TextureCache* cache = nullptr;
+    void* entry = nullptr;
+
+    TextureHandle(TextureCache* owner, void* cached);
+};
+
+// Textures by asset name, loaded once and shared through handles.
+// Textures nobody holds stay cached until the estimated GPU memory goes over the budget,
+// then the least recently released ones are dropped first. Handles must not outlive the cache.
+struct TextureCache
+{
+    // Creates the texture of an asset name (also sets smoothing and repetition); prints its own errors
+    using Loader = std::function<bool(const std::string& name, sf::Texture& texture)>;
+
+    explicit TextureCache(Loader loader, size_t budgetBytes = 256u << 20);
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+    ~TextureCache();
+
+    // Cached texture, loading it on a miss; an empty handle if loading failed
+    TextureHandle acquire(const std::string& name);
+
+    void setBudget(size_t bytes);
+    size_t budget() const { return budgetBytes; }
+    size_t memoryUsed() const { return usedBytes; }
+    size_t textureCount() const { return entries.size(); }
+    size_t loads() const { return loadCount; }
+    size_t hits() const { return hitCount; }
+    size_t evictions() const { return evictionCount; }
+
+    // Estimated GPU memory of a texture: 4 bytes per texel
+    static size_t textureBytes(const sf::Texture& texture);
+
+private:
+    friend struct TextureHandle;
+    struct Entry
+    {
+        std::string name;
+        sf::Texture texture;
+        size_t bytes = 0;
+        int refs = 0;
+        bool isIdle = false;
+        std::list<Entry*>::iterator idlePos; // Position in idle while refs == 0
+    };
+
+    Loader loader;
+    std::unordered_map<std::string, std::unique_ptr<Entry>> entries;
+    std::list<Entry*> idle; // Unreferenced textures, most recently released first
+    size_t budgetBytes;
+    size_t usedBytes = 0;
+    size_t loadCount = 0, hitCount = 0, evictionCount = 0;
+
+    void addRef(Entry* entry);
+    void release(Entry* entry);
+    void trim();
+};
@@ -3,180 +3,121 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <map>
+
+#include "GameConstants.h"
+#include "AssetArchive.h"
+#include "AssetLoader.h"
+#include "Culling.h"
+#include "FixedTimestep.h"
+#include "FramePipeline.h"
+#include "Hud.h"
+#include "Input.h"
+#include "Log.h"
+#include "Profiler.h"
+#include "ProfilerOverlay.h"
+#include "Projection.h"
+#include "Replay.h"
+#include "RoadRenderer.h"
+#include "Simulation.h"
+#include "SpriteBatch.h"
+#include "TextureAtlas.h"
+#include "TextureCache.h"
+#include "Track.h"
+#include "TrackStream.h"
 
 using namespace sf;
 
-// Game constants
-const int width = 1024;
-const int height = 768;
-const int roadW = 2000;
-const int segL = 200; // segment length
-const float camD = 0.84f; // camera depth
-const int N_LINES = 1600;
-const int TOTAL_LAPS = 8; // Race ends after 8 laps
-const float desiredCarHeight = 150.0f; // Moved to global scope for consistency; was 150
-
-// Draw window
-void drawQuad(RenderWindow& w, Color c, int x1, int y1, int w1, int x2, int y2, int w2)
+// Add a sprite placed by the snapshot build, cutting off the rows from clip down (hidden by the hills in front)
+void drawClippedSprite(SpriteBatch& batch, const IntRect& rect, const ScreenBox& box, float clip)
 {
-    ConvexShape shape(4);
-    shape.setFillColor(c);
-    shape.setPoint(0, Vector2f(static_cast<float>(x1 - w1), static_cast<float>(y1)));
-    shape.setPoint(1, Vector2f(static_cast<float>(x2 - w2), static_cast<float>(y2)));
-    shape.setPoint(2, Vector2f(static_cast<float>(x2 + w2), static_cast<float>(y2)));
-    shape.setPoint(3, Vector2f(static_cast<float>(x1 + w1), static_cast<float>(y1)));
-    w.draw(shape);
+    int w = rect.width;
+    int h = rect.height;
+
+    float clipH = box.y + box.h - clip;
+    if (clipH < 0.0f) clipH = 0.0f;
+
+    if (clipH >= box.h) return;
+    // Recortar a parte escondida encurtando o retângulo da textura
+    IntRect visible(rect.left, rect.top, w, static_cast<int>(h - h * clipH / box.h));
+    batch.addSprite(visible, box.x, box.y, box.w / w, box.h / h);
 }
 
-// Draw lines
-struct Line
+// Stripe colours of segment n (unwrapped past the end of the ring), alternating every 3 segments
+void segmentColors(int n, const FrameSnapshot& f, Color& grass, Color& rumble, Color& road)
 {
-    float x, y, z; // 3d center of line
-    float X, Y, W; // screen coord
-    float curve, spriteX, clip, scale;
-    Sprite sprite;
-    bool isFinishLine; // Indica se é parte da linha de chegada
-
-    Line()
-    {
-        spriteX = curve = x = y = z = 0.0f;
-        isFinishLine = false;
-    }
+    bool light = (n / 3) % 2 != 0;
+    bool finishLine = f.isFinishLine(n);
+    grass = light ? Color(16, 200, 16) : Color(0, 154, 0);
+    rumble = finishLine ? Color::Black : (light ? Color(255, 255, 255) : Color(0, 0, 0));
+    road = finishLine ? Color::White : (light ? Color(107, 107, 107) : Color(105, 105, 105));
+}
 
-    void project(int camX, int camY, int camZ)
-    {
-        scale = camD / (z - static_cast<float>(camZ));
-        X = (1.0f + scale * (x - static_cast<float>(camX))) * width / 2.0f;
-        Y = (1.0f - scale * (y - static_cast<float>(camY))) * height / 2.0f;
-        W = scale * roadW * width / 2.0f;
+// Average stripe colours of count segments drawn as one span
+void mergedColors(int first, int count, const FrameSnapshot& f, Color& grass, Color& rumble, Color& road)
+{
+    int sum[3][3] = {};
+    for (int n = first; n < first + count; n++) {
+        Color c[3];
+        segmentColors(n, f, c[0], c[1], c[2]);
+        for (int s = 0; s < 3; s++) {
+            sum[s][0] += c[s].r;
+            sum[s][1] += c[s].g;
+            sum[s][2] += c[s].b;
+        }
     }
-
-    void drawSprite(RenderWindow& app)
-    {
-        Sprite s = sprite;
-        int w = s.getTextureRect().width;
-        int h = s.getTextureRect().height;
-
-        float destX = X + scale * spriteX * width / 2.0f;
-        float destY = Y + 4.0f;
-        float destW = static_cast<float>(w) * W / 266.0f;
-        float destH = static_cast<float>(h) * W / 266.0f;
-
-        destX += destW * spriteX; // offsetX
-        destY += destH * (-1.0f); // offsetY
-
-        float clipH = destY + destH - clip;
-        if (clipH < 0.0f) clipH = 0.0f;
-
-        if (clipH >= destH) return;
-        s.setTextureRect(IntRect(0, 0, w, static_cast<int>(h - h * clipH / destH)));
-        s.setScale(destW / w, destH / h);
-        s.setPosition(destX, destY);
-        app.draw(s);
+    Color* out[3] = { &grass, &rumble, &road };
+    for (int s = 0; s < 3; s++) {
+        *out[s] = Color(static_cast<Uint8>(sum[s][0] / count), static_cast<Uint8>(sum[s][1] / count), static_cast<Uint8>(sum[s][2] / count));
     }
-};
+}
 
-// Opponent structure
-struct Opponent
+// Control of a game key, if it has one
+bool keyControl(Keyboard::Key key, Control& control)
 {
-    float pos; // Position along track
-    float opponentX; // Lateral position
-    float speed; // Current speed
-    float baseSpeed; // Base speed (constant)
-    int laps; // Laps completed
-    Sprite sprite; // Opponent car sprite
-    bool finished; // Whether opponent has finished the race
-    float targetX; // Target lateral position for smoother movement
-
-    Opponent(float startPos, float x, float spd, Texture& tex)
-        : pos(startPos), opponentX(x), speed(spd), baseSpeed(spd), laps(0), finished(false), targetX(x)
-    {
-        sprite.setTexture(tex);
-    }
-
-    void update(float elapsedSeconds, std::vector<Line>& lines, bool raceStarted)
-    {
-        if (!raceStarted || finished) return;
-
-        // Get current segment and track properties
-        int currentSegment = static_cast<int>(pos / segL) % N_LINES;
-        float currentCurve = lines[currentSegment].curve;
-
-        // Move opponent
-        pos += speed * elapsedSeconds * 125.0f; // Match player's speed scaling
-        std::cout << "Opponent pos: " << pos << ", segment: " << currentSegment << ", laps: " << laps << std::endl;
-        while (pos >= N_LINES * segL) {
-            pos -= N_LINES * segL;
-            laps++;
-            if (laps >= TOTAL_LAPS) {
-                finished = true;
-                std::cout << "Opponent finished race!" << std::endl;
-            }
-        }
-
-        // Update targetX to follow the inside of curves
-        targetX = -currentCurve * 0.5f; // Move toward inside of curve
-        float maxOpponentX = 0.8f; // Tighter limit to stay on road
-        if (targetX > maxOpponentX) targetX = maxOpponentX;
-        if (targetX < -maxOpponentX) targetX = -maxOpponentX;
-
-        // Smoothly adjust opponentX toward targetX
-        float steerSpeed = 0.3f; // Rate of lateral movement
-        opponentX += (targetX - opponentX) * steerSpeed * elapsedSeconds;
-
-        // Limit opponentX to stay on road
-        if (opponentX > maxOpponentX) opponentX = maxOpponentX;
-        if (opponentX < -maxOpponentX) opponentX = -maxOpponentX;
+    switch (key) {
+    case Keyboard::W: control = Control::Accelerate; return true;
+    case Keyboard::A: control = Control::Left; return true;
+    case Keyboard::D: control = Control::Right; return true;
+    case Keyboard::Up: control = Control::ShiftUp; return true;
+    case Keyboard::Down: control = Control::ShiftDown; return true;
+    default: return false;
     }
+}
 
-    void draw(RenderWindow& app, int playerPos, int camH, std::vector<Line>& lines)
-    {
-        if (finished) {
-            std::cout << "Opponent finished, not drawing." << std::endl;
-            return;
+// Função para mostrar a barra de progresso enquanto o loader trabalha
+void showLoadingScreen(RenderWindow& app, const AssetLoader& loader) {
+    RectangleShape frame(Vector2f(width * 0.6f, 24.f));
+    frame.setPosition(width * 0.2f, height / 2.f - 12.f);
+    frame.setFillColor(Color::Transparent);
+    frame.setOutlineColor(Color::White);
+    frame.setOutlineThickness(2.f);
+    RectangleShape bar(Vector2f(0.f, 24.f));
+    bar.setPosition(frame.getPosition());
+    bar.setFillColor(Color::White);
+
+    while (!loader.ready() && app.isOpen()) {
+        Event e;
+        while (app.pollEvent(e)) {
+            if (e.type == Event::Closed)
+                app.close();
         }
 
-        int opponentSegment = static_cast<int>(pos / segL) % N_LINES;
-        Line& l = lines[opponentSegment];
-        float relativeZ = l.z - (playerPos % (N_LINES * segL));
-        if (relativeZ < 0) relativeZ += N_LINES * segL;
-        std::cout << "Opponent segment: " << opponentSegment << ", relativeZ: " << relativeZ << std::endl;
-
-        // Remover restrição de visibilidade para teste
-        if (relativeZ < 10 || relativeZ > segL * 100) {
-             std::cout << "Opponent out of range: relativeZ = " << relativeZ << std::endl;
-             return;
-         }
-
-        // Usar projeção semelhante à Line::drawSprite
-        float scale = camD / std::max(relativeZ, 1.0f);
-        float destX = l.X + scale * opponentX * width / 2.0f;
-        float destY = l.Y + 4.0f;
-
-        Sprite s = sprite;
-        int w = s.getTextureRect().width;
-        int h = s.getTextureRect().height;
-
-        float baseScale = desiredCarHeight / static_cast<float>(h); // Mesma altura base do jogador
-        float distanceScale = std::max(0.1f, (1.0f / relativeZ) * 2400.0f);
-        float finalScale = std::max(0.1f, std::min(baseScale * distanceScale, 5.0f)); // Limitar escala - 1
-        float destW = static_cast<float>(w) * finalScale;
-        float destH = static_cast<float>(h) * finalScale;
-
-        destX += destW * opponentX; // offsetX
-        destY -= destH; // offsetY para alinhar com a pista
-
-        s.setScale(destW / w, destH / h);
-        s.setPosition(destX, destY);
-        app.draw(s);
-        std::cout << "Drawing opponent at X: " << destX << ", Y: " << destY << ", Scale: " << (destW / w)
-            << ", relativeZ: " << relativeZ << ", opponentX: " << opponentX
-            << ", w: " << w << ", h: " << h << std::endl;
+        float progress = static_cast<float>(loader.finished()) / loader.total();
+        bar.setSize(Vector2f(frame.getSize().x * progress, 24.f));
+        app.clear(Color::Black);
+        app.draw(frame);
+        app.draw(bar);
+        app.display();
     }
-};
+}
 
 // Função para mostrar tela de introdução e contagem regressiva
-void showIntroScreen(RenderWindow& app, Font& font) {
+void showIntroScreen(RenderWindow& app, Font& font, const std::function<void()>& firstFrameShown) {
     Text introText("", font, 30);
     introText.setFillColor(Color::White);
 
@@ -192,18 +133,16 @@ void showIntroScreen(RenderWindow& app, Font& font) {
         "Press Enter to Start!"
     };
 
-    bool waiting = true;
+    bool waiting = true, shown = false;
     while (waiting && app.isOpen()) {
         Event e;
         while (app.pollEvent(e)) {
             if (e.type == Event::Closed)
                 app.close();
+            if (e.type == Event::KeyPressed && e.key.code == Keyboard::Enter)
+                waiting = false;
         }
-
-        if (Keyboard::isKeyPressed(Keyboard::Enter)) {
-            waiting = false;
-            break;
-        }
+        if (!waiting) break;
 
         app.clear(Color::Black);
 
@@ -214,6 +153,10 @@ void showIntroScreen(RenderWindow& app, Font& font) {
         }
 
         app.display();
+        if (!shown) {
+            shown = true;
+            firstFrameShown();
+        }
     }
 
     // Contador regressivo 3..2..1
@@ -246,7 +189,9 @@ void showResultScreen(RenderWindow& app, Font& font, int playerPosition) {
     resultText.setFillColor(Color::White);
     resultText.setOutlineColor(Color::Black);
     resultText.setOutlineThickness(2.f);
-    std::string positionStr = (playerPosition == 1) ? "1st" : (playerPosition == 2) ? "2nd" : "3rd";
+    int lastTwo = playerPosition % 100;
+    const char* suffix = (lastTwo >= 11 && lastTwo <= 13) ? "th" : (playerPosition % 10 == 1) ? "st" : (playerPosition % 10 == 2) ? "nd" : (playerPosition % 10 == 3) ? "rd" : "th";
+    std::string positionStr = std::to_string(playerPosition) + suffix;
     resultText.setString("Race Finished!\nYour Position: " + positionStr);
     resultText.setPosition(width / 2.f - 400.f, height / 2.f - 50.f);
 
@@ -267,151 +212,262 @@ void showResultScreen(RenderWindow& app, Font& font, int playerPosition) {
     }
 }
 
-int main()
+int main(int argc, char** argv)
 {
-    RenderWindow app(VideoMode(width, height), "TopGear Racing!");
-    app.setFramerateLimit(60);
-
-    Texture t[50];
-    Sprite object[50];
-    for (int i = 1; i <= 7; i++)
-    {
-        std::string filename = "images/" + std::to_string(i) + ".png";
-        if (!t[i].loadFromFile(filename)) {
-            std::cerr << "Failed to load image: " << filename << std::endl;
+    const long long launchNs = profileNowNs();
+    LogSession logSession;
+
+    float simRate = SIM_RATE;
+    std::string recordFile, replayFile, trackFile, archiveFile, packFile;
+    bool bench = false;
+    bool pipelined = true; // Simulação numa thread e desenho na principal
+    bool hudBench = false;
+    int opponentCount = 2;
+    size_t textureBudget = 256u << 20; // Estimativa da memória de GPU das texturas
+    bool streamed = false; // Pista gerada a partir de uma semente, em pedaços
+    unsigned streamSeed = 0;
+    int lapLength = 4000;
+    DrawSettings drawSettings;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--sim-rate" && i + 1 < argc) simRate = static_cast<float>(std::atof(argv[++i]));
+        else if (arg == "--record" && i + 1 < argc) recordFile = argv[++i];
+        else if (arg == "--replay" && i + 1 < argc) replayFile = argv[++i];
+        else if (arg == "--bench") bench = true;
+        else if (arg == "--serial") pipelined = false;
+        else if (arg == "--bench-hud") hudBench = true;
+        else if (arg == "--track" && i + 1 < argc) trackFile = argv[++i];
+        else if (arg == "--stream" && i + 1 < argc) {
+            streamed = true;
+            streamSeed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--lap" && i + 1 < argc) lapLength = std::atoi(argv[++i]);
+        else if (arg == "--assets" && i + 1 < argc) archiveFile = argv[++i];
+        else if (arg == "--pack" && i + 1 < argc) packFile = argv[++i];
+        else if (arg == "--texture-budget" && i + 1 < argc) {
+            // Megabytes; a typo must not become a budget of 0 that evicts everything
+            char* end = nullptr;
+            double mb = std::strtod(argv[++i], &end);
+            if (end == argv[i] || *end != '\0' || !(mb >= 0.0) || mb > static_cast<double>(std::numeric_limits<size_t>::max() >> 20)) {
+                std::cerr << "Invalid texture budget: " << argv[i] << std::endl;
+                return -1;
+            }
+            textureBudget = static_cast<size_t>(mb * 1024 * 1024);
+        }
+        else if (arg == "--opponents" && i + 1 < argc) opponentCount = std::atoi(argv[++i]);
+        else if (arg == "--draw-distance" && i + 1 < argc) drawSettings.drawDistance = std::atoi(argv[++i]);
+        else if (arg == "--lod" && i + 1 < argc) drawSettings.lodPixels = static_cast<float>(std::atof(argv[++i]));
+        else if (arg == "--log" && i + 1 < argc && !logConfigure(argv[++i])) {
+            std::cerr << "Invalid log spec: " << argv[i] << std::endl;
             return -1;
         }
-        t[i].setSmooth(true);
-        object[i].setTexture(t[i]);
     }
 
-    Texture bg;
-    if (!bg.loadFromFile("images/bg.png")) {
-        std::cerr << "Failed to load background image." << std::endl;
+    // Tudo o que o jogo carrega, de arquivos soltos ou do pacote
+    AssetManifest manifest;
+    // O cenário é suavizado; os carros são pixel art e ficam sem filtro, numa página à parte
+    manifest.atlases = { { "atlas", true, { "1", "2", "3", "4", "5", "6", "7" } },
+        { "cars", false, { "car", "car_left", "car_right", "blue_car", "yellow_car" } } };
+    manifest.images = { "bg" };
+    manifest.files = { { "font", "fonts/PressStart2P-Regular.ttf" } };
+    if (!packFile.empty()) return packAssetArchive(packFile, manifest) ? 0 : -1;
+
+    // Gravação/reprodução dos comandos de cada tick
+    InputRecording recording;
+    bool replaying = !replayFile.empty();
+    if (replaying) {
+        if (!recording.loadFromFile(replayFile)) return -1;
+        simRate = recording.simRate;
+    }
+    else if (bench) {
+        std::cerr << "--bench needs --replay <file>." << std::endl;
         return -1;
     }
-    bg.setRepeated(true);
-    Sprite sBackground(bg);
-    sBackground.setTextureRect(IntRect(0, 0, 5000, 411));
-    sBackground.setPosition(-2000.0f, 0.0f);
+    if (simRate <= 0.0f) {
+        std::cerr << "Invalid simulation rate." << std::endl;
+        return -1;
+    }
+    recording.simRate = simRate;
 
-    // Carregar texturas dos adversários
-    Texture blueOpponentTexture, yellowOpponentTexture;
-    if (!blueOpponentTexture.loadFromFile("images/blue_car.png")) {
-        std::cerr << "Failed to load blue car texture." << std::endl;
+    if (opponentCount < 0) {
+        std::cerr << "Invalid number of opponents." << std::endl;
         return -1;
     }
-    if (!yellowOpponentTexture.loadFromFile("images/yellow_car.png")) {
-        std::cerr << "Failed to load yellow car texture." << std::endl;
+    if (lapLength < MIN_STREAM_LAP) {
+        std::cerr << "Invalid lap length." << std::endl;
+        return -1;
+    }
+    if (drawSettings.drawDistance < DRAW_DISTANCE || drawSettings.drawDistance > MAX_DRAW_DISTANCE) {
+        std::cerr << "Draw distance must be between " << DRAW_DISTANCE << " and " << MAX_DRAW_DISTANCE << " segments." << std::endl;
+        return -1;
+    }
+    if (drawSettings.lodPixels < 0.0f) {
+        std::cerr << "Invalid level of detail." << std::endl;
         return -1;
     }
 
+    // Imagens e fonte decodificadas em paralelo, junto com a construção da pista,
+    // enquanto a janela abre e a tela de carregamento é mostrada.
+    // Com --assets vêm já decodificadas do pacote mapeado e o loader só constrói a pista.
+    Track track;
+    AssetLoader loader;
+    AssetArchive archive;
+    const bool useArchive = !archiveFile.empty();
+    std::vector<std::vector<size_t>> atlasJobs(manifest.atlases.size());
+    size_t bgJob = 0, fontJob = 0;
+    if (!useArchive) {
+        for (size_t p = 0; p < manifest.atlases.size(); p++) {
+            for (const std::string& name : manifest.atlases[p].images) atlasJobs[p].push_back(loader.addImage(name, "images/" + name + ".png"));
+        }
+        bgJob = loader.addImage(manifest.images[0], "images/" + manifest.images[0] + ".png");
+        fontJob = loader.addFile("font", manifest.files[0].second);
+    }
 
-    std::vector<Line> lines;
-    for (int i = 0; i < N_LINES; i++)
-    {
-        Line line;
-        line.z = static_cast<float>(i * segL);
-
-        if (i > 300 && i < 700) line.curve = 0.5f;
-        if (i > 1100) line.curve = -0.7f;
+    // Pista binária mapeada do disco, gerada em pedaços, ou a pista embutida
+    loader.addTask("track", [&]() {
+        if (!trackFile.empty()) return track.loadFromFile(trackFile);
+        if (streamed) track.createStream(streamSeed, lapLength);
+        else track = buildDefaultTrack();
+        return true;
+    });
+    long long loadStartNs = profileNowNs();
+    loader.start();
+    if (useArchive && (!archive.open(archiveFile) || !archive.check(manifest, archiveFile))) {
+        loader.wait();
+        return -1;
+    }
 
-        if (i < 300 && i % 20 == 0) { line.spriteX = -2.5f; line.sprite = object[5]; }
-        if (i % 17 == 0) { line.spriteX = 2.0f; line.sprite = object[6]; }
-        if (i > 300 && i % 20 == 0) { line.spriteX = -0.7f; line.sprite = object[4]; }
-        if (i > 800 && i % 20 == 0) { line.spriteX = -1.2f; line.sprite = object[1]; }
-        if (i == 400) { line.spriteX = -1.2f; line.sprite = object[7]; }
+    RenderWindow app(VideoMode(width, height), "TopGear Racing!");
+    // No benchmark cada frame avança um tick e é desenhado o mais rápido possível
+    if (bench) {
+        app.setFramerateLimit(0);
+        app.setVerticalSyncEnabled(false);
+    }
+    else app.setFramerateLimit(60);
+
+    showLoadingScreen(app, loader);
+    if (!loader.wait()) return -1;
+    long long loadEndNs = profileNowNs();
+
+    // Texturas por nome, criadas na thread da janela a partir das imagens decodificadas
+    // ou direto das páginas do pacote mapeado, sem decodificar nem copiar.
+    // As que ninguém usa saem primeiro quando a memória passar do orçamento.
+    std::vector<Image> atlasImages(manifest.atlases.size());
+    std::map<std::string, const Image*> decoded;
+    TextureCache textures([&](const std::string& name, Texture& texture) {
+        bool ok;
+        if (useArchive) {
+            const AssetArchiveEntry* entry = archive.find(name);
+            ok = entry && entry->kind == AssetKind::Image && texture.create(entry->width, entry->height);
+            if (ok) texture.update(archive.data(*entry));
+        }
+        else {
+            auto it = decoded.find(name);
+            ok = it != decoded.end() && texture.loadFromImage(*it->second);
+        }
+        if (!ok) {
+            std::cerr << "Failed to create texture: " << name << std::endl;
+            return false;
+        }
+        // Só as páginas de atlas marcadas são suavizadas; o fundo se repete na horizontal
+        bool smooth = false;
+        for (const AtlasPage& page : manifest.atlases) smooth = smooth || (page.name == name && page.smooth);
+        texture.setSmooth(smooth);
+        texture.setRepeated(name == "bg");
+        return true;
+    }, textureBudget);
+
+    // Cenário numa textura e carros em outra; o passe de sprites só troca de textura entre as duas
+    std::vector<TextureAtlas> atlases(manifest.atlases.size());
+    // A fonte lê os bytes sob demanda, então o loader e o pacote precisam viver até o fim do main
+    Font font;
+    bool fontOk;
+    if (useArchive) {
+        for (size_t p = 0; p < manifest.atlases.size(); p++) {
+            for (const std::string& name : manifest.atlases[p].images) {
+                const AssetArchiveEntry* entry = archive.find(name);
+                atlases[p].rects[name] = IntRect(entry->left, entry->top, static_cast<int>(entry->width), static_cast<int>(entry->height));
+            }
+        }
+        const AssetArchiveEntry* entry = archive.find("font");
+        fontOk = font.loadFromMemory(archive.data(*entry), static_cast<size_t>(entry->size));
+    }
+    else {
+        for (size_t p = 0; p < manifest.atlases.size(); p++) {
+            std::vector<const Image*> images;
+            for (size_t job : atlasJobs[p]) images.push_back(&loader.image(job));
+            if (!atlases[p].pack(manifest.atlases[p].images, images, atlasImages[p])) return -1;
+            decoded[manifest.atlases[p].name] = &atlasImages[p];
+        }
+        decoded[manifest.images[0]] = &loader.image(bgJob);
+        const std::vector<char>& fontBytes = loader.bytes(fontJob);
+        fontOk = font.loadFromMemory(fontBytes.data(), fontBytes.size());
+    }
+    for (size_t p = 0; p < manifest.atlases.size(); p++) {
+        atlases[p].texture = textures.acquire(manifest.atlases[p].name);
+        if (!atlases[p].texture) return -1;
+    }
+    const TextureAtlas& atlas = atlases[0];
+    const TextureAtlas& carAtlas = atlases[1];
+    TextureHandle bg = textures.acquire("bg");
+    if (!bg) return -1;
+    if (!fontOk) {
+        std::cerr << "Failed to load font." << std::endl;
+        return -1;
+    }
 
-        if (i > 750) line.y = sin(i / 30.0f) * 1500.0f;
+    IntRect objectRect[8];
+    for (int i = 1; i <= 7; i++) objectRect[i] = atlas.get(std::to_string(i));
 
-        if (i >= 0 && i < 10) line.isFinishLine = true;
+    Sprite sBackground(*bg);
+    sBackground.setTextureRect(IntRect(0, 0, 5000, 411));
+    sBackground.setPosition(-2000.0f, 0.0f);
 
-        lines.push_back(line);
+    const int N = track.size();
+    Simulation sim(track, opponentCount);
+    if (replaying) {
+        // O balanço não tem opção no jogo e vem da gravação, como a taxa da simulação; o resto tem de coincidir
+        if (recording.hasSetup) {
+            sim.gasPickupRate = recording.setup.gasPickupRate;
+            sim.obstacleSpeedFactor = recording.setup.obstacleSpeedFactor;
+            std::string mismatch = raceSetupMismatch(recording.setup, sim.setup());
+            if (!mismatch.empty()) {
+                std::cerr << "Recording " << replayFile << " does not match this race:\n" << mismatch;
+                return -1;
+            }
+        }
+        else std::cerr << "Warning: " << replayFile << " does not store its race setup; it replays as recorded only with the options it was made with." << std::endl;
     }
 
-    float playerX = 0.0f;
-    int pos = (N_LINES - 20) * segL; // Inicia o carro 20 segmentos antes da linha de chegada
-    const int H = 900;
-    float speed = 0.0f;
-    int lapsCompleted = 0;
-    float carGas = 100.0f;
-    bool raceStarted = false;
-    bool playerFinished = false;
-
-    int gear = 1;
-    const int maxGear = 5;
-    float gearMaxSpeed[] = { 0, 30 * 3, 60 * 3, 90 * 3, 110 * 3, 133 * 3 };
-    float gearAcceleration[] = { 0, 12.0f, 10.0f, 7.0f, 5.0f, 3.0f };
-
-    // Inicializar adversários mais próximos com texturas diferentes
-    std::vector<Opponent> opponents = {
-        Opponent((N_LINES - 4) * segL, -0.8f, 200.0f, blueOpponentTexture), // old velocity was 100 and 110
-        Opponent((N_LINES - 2) * segL,  0.8f, 220.0f, yellowOpponentTexture)
+    // Carros dos adversários, alternando as cores pela ordem de sim.opponents
+    std::vector<IntRect> opponentRects = { carAtlas.get("blue_car"), carAtlas.get("yellow_car") };
+
+    auto reportStartup = [&]() {
+        std::cout << "Startup: " << (profileNowNs() - launchNs) / 1e6 << " ms to first frame (assets from "
+            << (useArchive ? archiveFile : "images/ and fonts/") << ", loading took " << (loadEndNs - loadStartNs) / 1e6 << " ms)" << std::endl;
+        std::cout << "Textures: " << textures.textureCount() << " loaded, " << textures.memoryUsed() / 1024 << " KiB of a "
+            << textures.budget() / 1024 << " KiB budget" << std::endl;
     };
 
-    Font font;
-    if (!font.loadFromFile("fonts/PressStart2P-Regular.ttf")) {
-        std::cerr << "Failed to load font." << std::endl;
-        return -1;
+    if (hudBench) {
+        benchmarkHud(font);
+        return 0;
     }
 
     // Tela de introdução e contagem regressiva
-    showIntroScreen(app, font);
-
-    // Criar textos HUD
-    Text velocityText("", font, 30);
-    velocityText.setFillColor(Color::White);
-    velocityText.setPosition(20.0f, 100.0f);
-    velocityText.setOutlineColor(Color::Black);
-    velocityText.setOutlineThickness(2.f);
-
-    Text gasText("", font, 30);
-    gasText.setFillColor(Color::White);
-    gasText.setPosition(20.0f, 300.0f);
-    gasText.setOutlineColor(Color::Black);
-    gasText.setOutlineThickness(2.f);
-
-    Text lapCounterText("", font, 30);
-    lapCounterText.setFillColor(Color::White);
-    lapCounterText.setPosition(20.0f, 60.0f);
-    lapCounterText.setOutlineColor(Color::Black);
-    lapCounterText.setOutlineThickness(2.f);
-
-    Text gearText("", font, 30);
-    gearText.setFillColor(Color::Yellow);
-    gearText.setPosition(20.0f, 140.0f);
-    gearText.setOutlineColor(Color::Black);
-    gearText.setOutlineThickness(2.f);
-
-    Text grassText("", font, 30);
-    grassText.setFillColor(Color::Red);
-    grassText.setPosition(20.0f, 340.0f);
-    grassText.setOutlineColor(Color::Black);
-    grassText.setOutlineThickness(2.f);
-
-    Text positionText("", font, 30);
-    positionText.setFillColor(Color::Cyan);
-    positionText.setPosition(20.0f, 180.0f);
-    positionText.setOutlineColor(Color::Black);
-    positionText.setOutlineThickness(2.f);
+    if (!bench) showIntroScreen(app, font, reportStartup);
+    else reportStartup();
+
+    Hud hud(font);
 
     Clock clock;
     float elapsedSeconds = 0.0f;
-    int lastStartPos = (N_LINES - 20);
-    bool isOnGrass = false;
 
     // Carro do jogador
-    Texture carTexture, carLeftTexture, carRightTexture;
-    if (!carTexture.loadFromFile("images/car.png") ||
-        !carLeftTexture.loadFromFile("images/car_left.png") ||
-        !carRightTexture.loadFromFile("images/car_right.png")) {
-        std::cerr << "Failed to load car textures." << std::endl;
-        return -1;
-    }
-
-    Sprite carSprite(carTexture);
-    auto setCarTexture = [&](Texture& tex, float extraHeightScale = 1.0f) {
-        carSprite.setTexture(tex, true);
+    IntRect carRect = carAtlas.get("car"), carLeftRect = carAtlas.get("car_left"), carRightRect = carAtlas.get("car_right");
+    Sprite carSprite(*carAtlas.texture, carRect);
+    auto setCarFrame = [&](const IntRect& rect, float extraHeightScale = 1.0f) {
+        carSprite.setTextureRect(rect);
         float scaleY = desiredCarHeight / carSprite.getLocalBounds().height;
         scaleY *= extraHeightScale;
         float scaleX = scaleY;
@@ -419,225 +475,195 @@ int main()
         carSprite.setPosition(width / 2.f - carSprite.getGlobalBounds().width / 2.0f,
             height * 0.7f);
         };
-    setCarTexture(carTexture);
+    setCarFrame(carRect);
+
+    // Simulação em passo fixo; o desenho interpola entre os dois últimos ticks.
+    // A thread da simulação prepara o frame seguinte enquanto este é desenhado.
+    FixedTimestep timestep(simRate);
+    FramePipeline pipeline(sim, timestep, recording, replaying, !replaying && !recordFile.empty(), bench, pipelined);
+    SpriteSizes spriteSizes;
+    for (int i = 1; i <= 7; i++) {
+        spriteSizes.sceneryW[i] = static_cast<float>(objectRect[i].width);
+        spriteSizes.sceneryH[i] = static_cast<float>(objectRect[i].height);
+    }
+    for (const IntRect& rect : opponentRects) {
+        spriteSizes.carW.push_back(static_cast<float>(rect.width));
+        spriteSizes.carH.push_back(static_cast<float>(rect.height));
+    }
+    pipeline.setSpriteSizes(spriteSizes);
+    // A looping track is projected at most one lap ahead
+    if (!track.isStreamed() && drawSettings.drawDistance >= N) {
+        LOG_INFO(LogCategory::Render, "Draw distance %d is longer than the track; using %d", drawSettings.drawDistance, N - 1);
+        drawSettings.drawDistance = N - 1;
+    }
+    pipeline.setDrawSettings(drawSettings);
+
+    RoadRenderer roadRenderer;
+    SpriteBatch spriteBatch;
+    RenderStats renderStats;
+
+    std::vector<float> frameTimes;
+    Clock benchClock, frameClock;
+
+    ProfilerOverlay profilerOverlay(font);
+    InputTracker input;
+    app.setKeyRepeatEnabled(false);
+    // Teclas já seguradas durante a contagem regressiva (uma única consulta, depois só eventos)
+    Control control;
+    for (Keyboard::Key key : { Keyboard::W, Keyboard::A, Keyboard::D, Keyboard::Up, Keyboard::Down }) {
+        if (!bench && keyControl(key, control) && Keyboard::isKeyPressed(key)) input.press(control);
+    }
 
-    bool canShiftDown = true;
+    pipeline.request(FrameRequest());
+    const FrameSnapshot* frame = &pipeline.wait();
 
     while (app.isOpen()) {
-        Event e;
-        while (app.pollEvent(e)) {
-            if (e.type == Event::Closed) app.close();
-        }
-
-        elapsedSeconds = clock.restart().asSeconds();
-
-        // Iniciar corrida na primeira pressão de W
-        if (Keyboard::isKeyPressed(Keyboard::W) && !raceStarted) {
-            raceStarted = true;
-            std::cout << "Race Started!" << std::endl;
-        }
-
-        // Atualizar adversários
-        for (auto& opponent : opponents) {
-            opponent.update(elapsedSeconds, lines, raceStarted);
-        }
-
-        // Get the current segment's curve
-        int currentSegment = pos / segL;
-        float currentCurve = lines[currentSegment % N_LINES].curve;
+        PROFILE_FRAME_BEGIN();
 
-        // Curve influence on playerX
-        float curveInfluence = currentCurve * elapsedSeconds * (speed / 200.0f);
-        playerX += curveInfluence;
-
-        // Steering input (A: move left, D: move right)
-        float steeringForce = 0.6f;
-        if (speed >= 50) {
-            if (Keyboard::isKeyPressed(Keyboard::A)) {
-                playerX -= steeringForce * elapsedSeconds;
-                setCarTexture(carLeftTexture, 1.25f);
-            }
-            else if (Keyboard::isKeyPressed(Keyboard::D)) {
-                playerX += steeringForce * elapsedSeconds;
-                setCarTexture(carRightTexture, 1.25f);
-            }
-            else {
-                setCarTexture(carTexture);
+        // Os comandos vêm dos eventos de teclado, sem consultar o estado das teclas
+        {
+            PROFILE_SCOPE(ProfilePhase::EventPoll);
+            Event e;
+            while (app.pollEvent(e)) {
+                if (e.type == Event::Closed) app.close();
+                if (e.type == Event::LostFocus) input.releaseAll();
+                if (e.type == Event::KeyPressed && e.key.code == Keyboard::F3) profilerOverlay.toggle();
+                if (e.type == Event::KeyPressed && keyControl(e.key.code, control)) input.press(control);
+                if (e.type == Event::KeyReleased && keyControl(e.key.code, control)) input.release(control);
             }
         }
-        else {
-            setCarTexture(carTexture);
-        }
-
-        // Verificar se o carro está na grama
-        isOnGrass = (std::abs(playerX * roadW) > roadW / 2.0f * 1.2f);
-        if (isOnGrass) {
-            std::cout << "On Grass! Speed: " << speed / 3 << " km/h, Gear: " << gear << ", Gas: " << carGas << std::endl;
-            speed -= 0.3f * elapsedSeconds;
-            if (speed < 0) speed = 0;
-        }
 
-        // Aceleração
-        if (Keyboard::isKeyPressed(Keyboard::W) && carGas > 0 && !playerFinished) {
-            float currentAcceleration = isOnGrass ? gearAcceleration[gear] * 0.8f : gearAcceleration[gear];
-            speed += currentAcceleration * elapsedSeconds;
-            float currentMaxSpeed = isOnGrass ? gearMaxSpeed[gear] * 0.8f : gearMaxSpeed[gear];
-            if (speed > currentMaxSpeed) speed = currentMaxSpeed;
-            std::cout << "Accelerating! Speed: " << speed / 3 << " km/h, Gear: " << gear << ", Gas: " << carGas << std::endl;
-        }
-        else {
-            speed -= 0.5f * elapsedSeconds;
-            if (speed < 0) speed = 0;
-        }
+        elapsedSeconds = clock.restart().asSeconds();
 
-        // Limit playerX
-        float maxPlayerX = 2.0f;
-        if (playerX > maxPlayerX) playerX = maxPlayerX;
-        if (playerX < -maxPlayerX) playerX = -maxPlayerX;
-
-        // Mudança de marchas
-        if (Keyboard::isKeyPressed(Keyboard::Up)) {
-            if (gear < maxGear && static_cast<int>(speed) >= gearMaxSpeed[gear] * 0.8f) {
-                gear++;
-                float currentMaxSpeed = isOnGrass ? gearMaxSpeed[gear] * 0.8f : gearMaxSpeed[gear];
-                if (speed > currentMaxSpeed) speed = currentMaxSpeed;
-                std::cout << "Upshifted to Gear: " << gear << std::endl;
-            }
-        }
-        if (Keyboard::isKeyPressed(Keyboard::Down)) {
-            if (canShiftDown && gear > 1) {
-                gear--;
-                std::cout << "Downshifted to Gear: " << gear << std::endl;
-                canShiftDown = false;
-            }
+        FrameRequest next;
+        next.elapsedSeconds = elapsedSeconds;
+        {
+            PROFILE_SCOPE(ProfilePhase::Input);
+            next.input = input.take();
         }
-        else canShiftDown = true;
-
-        // Atualizar posição do jogador
-        if (!playerFinished) {
-            pos += static_cast<int>(speed * elapsedSeconds * 125.0f);
-            while (pos >= N_LINES * segL) {
-                pos -= N_LINES * segL;
-                lapsCompleted++;
-                if (lapsCompleted >= TOTAL_LAPS) {
-                    playerFinished = true;
-                    std::cout << "Player finished race!" << std::endl;
-                }
-            }
-            while (pos < 0) pos += N_LINES * segL;
-        }
-
-        int startPos = pos / segL;
-        int camH = static_cast<int>(lines[startPos].y + H);
-        if (speed > 0) sBackground.move(-lines[startPos].curve * 2.f * elapsedSeconds * 5.0f, 0.f);
-        if (speed < 0) sBackground.move(lines[startPos].curve * 2.f * elapsedSeconds * 5.0f, 0.f);
 
-        // Contagem de voltas
-        int newPos = pos / segL;
-        if (lastStartPos >= N_LINES - 20 && newPos <= 9 && lines[newPos].isFinishLine) {
-            std::cout << "Lap completed! Total laps: " << lapsCompleted << std::endl;
-        }
-        lastStartPos = newPos;
-
-        // Calcular posição na corrida
-        std::vector<std::pair<float, int>> rankings; // {distância total, índice (0=player, 1=opponent1, 2=opponent2)}
-        rankings.push_back({ static_cast<float>(lapsCompleted * N_LINES * segL + pos), 0 });
-        rankings.push_back({ static_cast<float>(opponents[0].laps * N_LINES * segL + opponents[0].pos), 1 });
-        rankings.push_back({ static_cast<float>(opponents[1].laps * N_LINES * segL + opponents[1].pos), 2 });
-        std::sort(rankings.rbegin(), rankings.rend()); // Ordem decrescente
-
-        int playerPosition = 1;
-        for (size_t i = 0; i < rankings.size(); i++) {
-            if (rankings[i].second == 0) {
-                playerPosition = i + 1;
-                break;
-            }
-        }
-        positionText.setString("Position: " + std::to_string(playerPosition));
-
-        // Atualiza HUD
-        velocityText.setString("Velocity: " + std::to_string(static_cast<int>(speed) / 3) + " km/h");
-        gasText.setString("Gas: " + std::to_string(static_cast<int>(carGas)));
-        lapCounterText.setString("Laps: " + std::to_string(lapsCompleted) + "/" + std::to_string(TOTAL_LAPS));
-        gearText.setString("Gear: " + std::to_string(gear));
-        grassText.setString(isOnGrass ? "On Grass!" : "");
-
-        // Consumo de combustível
-        if (speed > 0 && carGas > 0) {
-            carGas -= ((speed / 20.0f) * elapsedSeconds / 6.f) * static_cast<float>(gear);
-            if (carGas < 0) carGas = 0;
-        }
-        if (carGas <= 0) {
-            speed -= 0.5f * elapsedSeconds;
-            if (speed < 0) speed = 0;
-            std::cout << "Out of Gas!" << std::endl;
+        // O frame seguinte é simulado enquanto este é desenhado
+        if (!frame->raceOver && !frame->replayEnded) pipeline.request(next);
+        long long renderStartNs = profileNowNs();
+        const FrameSnapshot& f = *frame;
+        const ProjectedTrack& proj = f.proj;
+
+        if (f.playerSteer < 0) setCarFrame(carLeftRect, 1.25f);
+        else if (f.playerSteer > 0) setCarFrame(carRightRect, 1.25f);
+        else setCarFrame(carRect);
+
+        sBackground.setPosition(-2000.0f + f.cars.backgroundX, 0.0f);
+
+        // Atualiza HUD (só os campos que mudaram)
+        HudValues hudValues;
+        hudValues.laps = f.laps;
+        hudValues.speedKmh = static_cast<int>(f.speed) / 3;
+        hudValues.gear = f.gear;
+        hudValues.position = f.playerPosition;
+        hudValues.gas = static_cast<int>(f.gas);
+        hudValues.onGrass = f.onGrass;
+        {
+            PROFILE_SCOPE(ProfilePhase::Hud);
+            hud.update(hudValues);
         }
 
         app.clear(Color(105, 205, 4));
         app.draw(sBackground);
-
-        int maxy = height; float x = 0.f, dx = 0.f;
+        renderStats.reset();
 
         // Desenhar a pista
-        for (int n = startPos; n < startPos + 300; n++) {
-            Line& l = lines[n % N_LINES];
-            l.project(static_cast<int>(playerX * roadW - x), camH, startPos * segL - (n >= N_LINES ? N_LINES * segL : 0));
-
-            if (l.sprite.getTexture() == object[7].getTexture()) {
-                float spriteTop = l.Y + 4.f - (l.W * l.sprite.getLocalBounds().height / 266.f);
-                float spriteBottom = l.Y + 4.f;
-                float carTop = carSprite.getPosition().y;
-                float carBottom = carTop + carSprite.getGlobalBounds().height;
-                if (carBottom > spriteTop && carTop < spriteBottom) {
-                    carGas = carGas + 2.0f;
-                    std::cout << "Collected Gas! Gas: " << carGas << std::endl;
-                }
+        {
+            PROFILE_SCOPE(ProfilePhase::RoadEmission);
+            roadRenderer.begin();
+            for (const RoadSpan& span : f.roadSpans) {
+                Color grass, rumble, road;
+                if (span.count == 1) segmentColors(span.first, f, grass, rumble, road);
+                else mergedColors(span.first, span.count, f, grass, rumble, road);
+
+                // O primeiro segmento fica sempre atrás da câmara, por isso o anterior já foi projetado
+                int p = (span.nearLine + N) % N;
+                int i = span.farLine % N;
+                int pX = static_cast<int>(proj.X[p]), pY = static_cast<int>(proj.Y[p]);
+                int lX = static_cast<int>(proj.X[i]), lY = static_cast<int>(proj.Y[i]);
+                roadRenderer.addQuad(grass, 0, pY, width, 0, lY, width);
+                if (!span.roadOnScreen) continue;
+                roadRenderer.addQuad(rumble, pX, pY, static_cast<int>(proj.W[p] * 1.2f), lX, lY, static_cast<int>(proj.W[i] * 1.2f));
+                roadRenderer.addQuad(road, pX, pY, static_cast<int>(proj.W[p]), lX, lY, static_cast<int>(proj.W[i]));
             }
-
-            x += dx;
-            dx += l.curve;
-
-            l.clip = static_cast<float>(maxy);
-            if (l.Y >= maxy) continue;
-            maxy = static_cast<int>(l.Y);
-
-            Color grass = (n / 3) % 2 ? Color(16, 200, 16) : Color(0, 154, 0);
-            Color rumble = l.isFinishLine ? Color::Black : ((n / 3) % 2 ? Color(255, 255, 255) : Color(0, 0, 0));
-            Color road = l.isFinishLine ? Color::White : ((n / 3) % 2 ? Color(107, 107, 107) : Color(105, 105, 105));
-
-            Line p = lines[(n - 1) % N_LINES];
-            drawQuad(app, grass, 0, p.Y, width, 0, l.Y, width);
-            drawQuad(app, rumble, static_cast<int>(p.X), static_cast<int>(p.Y), static_cast<int>(p.W * 1.2f),
-                static_cast<int>(l.X), static_cast<int>(l.Y), static_cast<int>(l.W * 1.2f));
-            drawQuad(app, road, static_cast<int>(p.X), static_cast<int>(p.Y), static_cast<int>(p.W),
-                static_cast<int>(l.X), static_cast<int>(l.Y), static_cast<int>(l.W));
+            roadRenderer.flush(app, renderStats);
         }
 
-        // Desenhar sprites da pista (de trás para frente)
-        for (int n = startPos + 300; n > startPos; n--) {
-            lines[n % N_LINES].drawSprite(app);
+        // Sprites da pista e adversários de trás para frente, e o carro do jogador: uma chamada por troca
+        // entre o atlas do cenário e o dos carros.
+        // The snapshot build already left out what the hills hide or the screen misses, and grouped
+        // the sprites of each page where they do not overlap the other page.
+        spriteBatch.begin(*atlas.texture);
+        {
+            PROFILE_SCOPE(ProfilePhase::SpritePass);
+            unsigned callsBefore = renderStats.drawCalls;
+            for (const SpriteDraw& d : f.sprites) {
+                spriteBatch.use(d.car >= 0 ? *carAtlas.texture : *atlas.texture, app, renderStats);
+                const IntRect& rect = d.car >= 0 ? opponentRects[d.car % opponentRects.size()] : objectRect[d.image];
+                drawClippedSprite(spriteBatch, rect, d.box, d.clip);
+            }
+            spriteBatch.use(*carAtlas.texture, app, renderStats);
+            spriteBatch.addSprite(carSprite.getTextureRect(), carSprite.getPosition().x, carSprite.getPosition().y,
+                carSprite.getScale().x, carSprite.getScale().y);
+            spriteBatch.flush(app, renderStats);
+            renderStats.spriteCalls = renderStats.drawCalls - callsBefore;
+            renderStats.spriteCallsDepthOrder = static_cast<unsigned>(f.depthOrderCalls);
         }
 
-        // Desenhar adversários após a pista, mas antes do carro do jogador
-        for (auto& opponent : opponents) {
-            opponent.draw(app, pos, camH, lines);
+        LOG_DEBUG_EVERY(1.0, LogCategory::Render, "Frame: %u draw calls, %u vertices", renderStats.drawCalls, renderStats.vertices);
+        PROFILE_COUNT(ProfileCounter::RoadHidden, f.cull.roadHidden);
+        PROFILE_COUNT(ProfileCounter::RoadOffScreen, f.cull.roadOffScreen);
+        PROFILE_COUNT(ProfileCounter::RoadDrawn, f.cull.roadDrawn);
+        PROFILE_COUNT(ProfileCounter::SpritesHidden, f.cull.spritesHidden);
+        PROFILE_COUNT(ProfileCounter::SpritesOffScreen, f.cull.spritesOffScreen);
+        PROFILE_COUNT(ProfileCounter::SpritesDrawn, f.cull.spritesDrawn);
+        PROFILE_COUNT(ProfileCounter::CarsHidden, f.cull.carsHidden);
+        PROFILE_COUNT(ProfileCounter::CarsOffScreen, f.cull.carsOffScreen);
+        PROFILE_COUNT(ProfileCounter::CarsDrawn, f.cull.carsDrawn);
+
+        {
+            PROFILE_SCOPE(ProfilePhase::Hud);
+            hud.draw(app, renderStats);
         }
-
-        app.draw(carSprite);
-        app.draw(lapCounterText);
-        app.draw(velocityText);
-        app.draw(gearText);
-        app.draw(gasText);
-        app.draw(grassText);
-        app.draw(positionText);
+        profilerOverlay.draw(app, renderStats);
 
         // Verificar fim da corrida
-        if (playerFinished) {
-            showResultScreen(app, font, playerPosition);
+        if (f.raceOver) {
+            if (!bench) showResultScreen(app, font, f.playerPosition);
             break; // Sai do loop principal após mostrar o resultado
         }
+        if (f.replayEnded) {
+            std::cout << "Replay ended before the race finished." << std::endl;
+            break;
+        }
 
-        app.display();
+        {
+            PROFILE_SCOPE(ProfilePhase::Display);
+            app.display();
+        }
+
+        long long renderEndNs = profileNowNs();
+        frame = &pipeline.wait();
+        PROFILE_STAGES(frame->buildStartNs, frame->buildEndNs, renderStartNs, renderEndNs);
+
+        PROFILE_FRAME_END();
+        if (bench) frameTimes.push_back(frameClock.restart().asSeconds() * 1000.0f);
+    }
+    pipeline.stop();
+
+    if (!replaying && !recordFile.empty()) {
+        recording.setup = sim.setup();
+        recording.saveToFile(recordFile);
+    }
+
+    if (bench) {
+        std::cout << "Replay: " << replayFile << ", " << pipeline.ticks() << " ticks at " << simRate << " Hz (intro and result screens skipped)" << std::endl;
+        std::cout << "Race time: " << sim.raceTime << " s, position: " << sim.playerPosition << std::endl;
+        printFrameTimes(frameTimes, benchClock.getElapsedTime().asSeconds());
     }
 
     return 0;
@@ -0,0 +1,240 @@
+#include "Track.h"
+#include "TrackStream.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+static const char trackMagic[4] = { 'T', 'G', 'T', 'K' };
+
+static size_t trackImageSize(int n)
+{
+    return sizeof(TrackFileHeader) + static_cast<size_t>(n) * (4 * sizeof(float) + 2);
+}
+
+Track::Track() = default;
+Track::Track(Track&&) = default;
+Track& Track::operator=(Track&&) = default;
+Track::~Track()
+{
+    stream.reset();
+}
+
+void Track::bind(const unsigned char* image, int n)
+{
+    const unsigned char* p = image + sizeof(TrackFileHeader);
+    z = reinterpret_cast<const float*>(p); p += n * sizeof(float);
+    y = reinterpret_cast<const float*>(p); p += n * sizeof(float);
+    curve = reinterpret_cast<const float*>(p); p += n * sizeof(float);
+    spriteX = reinterpret_cast<const float*>(p); p += n * sizeof(float);
+    isFinishLine = p; p += n;
+    sprite = p;
+    count = n;
+    lapSegments = n;
+}
+
+TrackArrays Track::create(int n)
+{
+    stream.reset();
+    mapping.close();
+    storage.assign(trackImageSize(n), 0);
+
+    TrackFileHeader header;
+    std::memcpy(header.magic, trackMagic, sizeof(header.magic));
+    header.version = TRACK_FILE_VERSION;
+    header.segmentCount = static_cast<unsigned int>(n);
+    header.reserved = 0;
+    std::memcpy(storage.data(), &header, sizeof(header));
+
+    bind(storage.data(), n);
+
+    TrackArrays a;
+    a.z = const_cast<float*>(z);
+    a.y = const_cast<float*>(y);
+    a.curve = const_cast<float*>(curve);
+    a.spriteX = const_cast<float*>(spriteX);
+    a.isFinishLine = const_cast<unsigned char*>(isFinishLine);
+    a.sprite = const_cast<unsigned char*>(sprite);
+    return a;
+}
+
+bool Track::loadFromFile(const std::string& filename)
+{
+    MappedFile file;
+    if (!file.open(filename)) {
+        std::cerr << "Failed to open track: " << filename << std::endl;
+        return false;
+    }
+
+    TrackFileHeader header;
+    if (file.size < sizeof(header)) {
+        std::cerr << "Invalid track file: " << filename << std::endl;
+        return false;
+    }
+    std::memcpy(&header, file.data, sizeof(header));
+    if (std::memcmp(header.magic, trackMagic, sizeof(trackMagic)) != 0 || header.version != TRACK_FILE_VERSION) {
+        std::cerr << "Invalid track file or version: " << filename << std::endl;
+        return false;
+    }
+    int n = static_cast<int>(header.segmentCount);
+    if (header.segmentCount > 0x7FFFFFFu || n < MIN_TRACK_SEGMENTS || file.size < trackImageSize(n)) {
+        std::cerr << "Invalid track size in " << filename << ": " << header.segmentCount << " segments" << std::endl;
+        return false;
+    }
+    for (int i = 0; i < n; i++) {
+        if (file.data[sizeof(header) + static_cast<size_t>(n) * (4 * sizeof(float) + 1) + i] > SPRITE_GAS) {
+            std::cerr << "Invalid sprite id in " << filename << " at segment " << i << std::endl;
+            return false;
+        }
+    }
+
+    stream.reset();
+    storage.clear();
+    mapping = std::move(file);
+    bind(mapping.data, n);
+    updateTables();
+    return true;
+}
+
+bool Track::saveToFile(const std::string& filename) const
+{
+    FILE* f = std::fopen(filename.c_str(), "wb");
+    if (!f) {
+        std::cerr << "Failed to create track: " << filename << std::endl;
+        return false;
+    }
+
+    // The bound arrays are already in file order behind the header
+    const unsigned char* image = reinterpret_cast<const unsigned char*>(z) - sizeof(TrackFileHeader);
+    bool ok = std::fwrite(image, 1, trackImageSize(count), f) == trackImageSize(count);
+    ok = std::fclose(f) == 0 && ok;
+    if (!ok) std::cerr << "Failed to write track: " << filename << std::endl;
+    return ok;
+}
+
+uint64_t Track::fingerprint() const
+{
+    if (stream) return 0;
+    // FNV-1a over the arrays, in file order behind the header
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(z);
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < trackImageSize(count) - sizeof(TrackFileHeader); i++) {
+        hash ^= data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+void Track::updateTables()
+{
+    heading.assign(count + 1, 0.0);
+    offset.assign(count + 1, 0.0);
+    for (int i = 0; i < count; i++) {
+        heading[i + 1] = heading[i] + curve[i];
+        offset[i + 1] = offset[i] + heading[i];
+    }
+}
+
+void Track::createStream(unsigned seed, int lapLength)
+{
+    const int n = STREAM_CHUNKS * STREAM_CHUNK;
+    TrackArrays a = create(n);
+    for (int i = 0; i < n; i++) a.z[i] = static_cast<float>(i * segL);
+    // Tabelas por posição do anel, preenchidas junto com cada pedaço
+    heading.assign(n, 0.0);
+    offset.assign(n, 0.0);
+    lapSegments = lapLength;
+
+    TrackGenerator generator;
+    generator.seed = seed;
+    generator.lapStart = n;
+    generator.lapLength = lapLength;
+    stream.reset(new TrackStream(generator, a, heading.data(), offset.data(), n));
+    follow(0, n - 20);
+}
+
+void Track::follow(int wraps, int segment) const
+{
+    if (stream) stream->follow(distance(wraps, segment));
+}
+
+float Track::streamedCurve(long long g) const
+{
+    return stream->curveAt(g);
+}
+
+// Segment, fraction and lap of a position, with the road offset there and its slope along the segment
+void Track::locate(double segment, int& i, double& t, double& lap, double& x, double& slope) const
+{
+    lap = std::floor(segment / count);
+    double local = segment - lap * count;
+    i = std::min(static_cast<int>(local), count - 1);
+    t = local - i;
+
+    // Anel de pista gerada: as tabelas guardam os valores do segmento que ocupa cada posição
+    if (stream) {
+        slope = heading[i];
+        x = offset[i] + t * slope;
+        return;
+    }
+
+    // Each lap starts turned by the heading of the whole lap and shifted by its offset
+    const double lapHeading = heading[count], lapOffset = offset[count];
+    slope = lap * lapHeading + heading[i];
+    x = lap * lapOffset + lapHeading * count * lap * (lap - 1.0) / 2.0 + lap * lapHeading * i + offset[i] + t * slope;
+}
+
+TrackPoint Track::pointAt(double segment) const
+{
+    int i; double t, lap, x, slope;
+    locate(segment, i, t, lap, x, slope);
+
+    int next = i + 1 < count ? i + 1 : 0;
+    TrackPoint p;
+    p.x = static_cast<float>(x);
+    p.y = static_cast<float>(y[i] + t * (y[next] - y[i]));
+    p.z = static_cast<float>((lap * count + t) * segL + z[i]);
+    p.curve = curve[i];
+    return p;
+}
+
+TrackPoint Track::pointFrom(double from, double segment) const
+{
+    int i; double t, lap, fromX, fromSlope;
+    locate(from, i, t, lap, fromX, fromSlope);
+
+    TrackPoint p = pointAt(segment);
+    int j; double x, slope;
+    locate(segment, j, t, lap, x, slope);
+    p.x = static_cast<float>(x - fromX - (segment - from) * fromSlope);
+    return p;
+}
+
+Track buildDefaultTrack(int segments)
+{
+    Track track;
+    TrackArrays a = track.create(segments);
+
+    for (int i = 0; i < segments; i++)
+    {
+        a.z[i] = static_cast<float>(i * segL);
+
+        if (i > 300 && i < 700) a.curve[i] = 0.5f;
+        if (i > 1100) a.curve[i] = -0.7f;
+
+        if (i < 300 && i % 20 == 0) { a.spriteX[i] = -2.5f; a.sprite[i] = 5; }
+        if (i % 17 == 0) { a.spriteX[i] = 2.0f; a.sprite[i] = 6; }
+        if (i > 300 && i % 20 == 0) { a.spriteX[i] = -0.7f; a.sprite[i] = 4; }
+        if (i > 800 && i % 20 == 0) { a.spriteX[i] = -1.2f; a.sprite[i] = 1; }
+        if (i == 400) { a.spriteX[i] = -1.2f; a.sprite[i] = SPRITE_GAS; }
+
+        if (i > 750) a.y[i] = std::sin(i / 30.0f) * 1500.0f;
+
+        if (i >= 0 && i < 10) a.isFinishLine[i] = 1;
+    }
+
+    track.updateTables();
+    return track;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "GameConstants.h"
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Scenery sprite ids (index into the images/1.png..7.png textures, 0 = no sprite)
+const int SPRITE_NONE = 0;
+const int SPRITE_GAS = 7; // Fuel pickup
+
+// Binary track file (.tgt), little-endian: this header followed by the arrays
+// z, y, curve, spriteX (float each) and isFinishLine, sprite (one byte each), segmentCount entries per array
+struct TrackFileHeader
+{
+    char magic[4]; // "TGTK"
+    unsigned int version;
+    unsigned int segmentCount;
+    unsigned int reserved;
+};
+
+const unsigned int TRACK_FILE_VERSION = 1;
+const int MIN_TRACK_SEGMENTS = DRAW_DISTANCE; // One full default draw distance
+
+// Writable arrays of a track being built in memory
+struct TrackArrays
+{
+    float* z;
+    float* y;
+    float* curve;
+    float* spriteX;
+    unsigned char* isFinishLine;
+    unsigned char* sprite;
+};
+
+// Road centre at a fractional segment position
+struct TrackPoint
+{
+    float x; // lateral offset
+    float y; // height
+    float z; // distance along the track
+    float curve; // curvature of the segment
+};
+
+struct TrackStream;
+
+// Road segments stored as packed arrays, all indexed by segment.
+// Projection, road drawing and the simulation only read the hot geometry;
+// the sprite table is only read by the sprite pass.
+// The arrays point into one block laid out like the track file: either owned memory
+// or the file mapped read-only, used in place without parsing or copying.
+// A streamed track uses the arrays as a ring: global segment g is stored at g % size() and
+// chunks are generated ahead of the camera, so everything that wraps indices around the
+// track works unchanged. Only laps differ, as a lap is no longer one pass over the arrays.
+struct Track
+{
+    // Hot geometry
+    const float* z = nullptr; // distance along the track
+    const float* y = nullptr; // height
+    const float* curve = nullptr;
+    const unsigned char* isFinishLine = nullptr;
+
+    // Cold sprite table: a prototype id per segment and its lateral offset
+    const unsigned char* sprite = nullptr;
+    const float* spriteX = nullptr;
+
+    Track();
+    Track(const Track&) = delete;
+    Track& operator=(const Track&) = delete;
+    Track(Track&&);
+    Track& operator=(Track&&);
+    ~Track();
+
+    int size() const { return count; }
+    bool isStreamed() const { return stream != nullptr; }
+    const TrackStream* streamer() const { return stream.get(); }
+
+    // Allocate n zeroed segments in owned memory
+    TrackArrays create(int n);
+    bool loadFromFile(const std::string& filename);
+    bool saveToFile(const std::string& filename) const;
+    // Hash of the segments of a looping track, to tell whether a recording was made on it; 0 when streamed
+    uint64_t fingerprint() const;
+
+    // Rebuild the prefix tables; call after filling the arrays from create()
+    void updateTables();
+    // Switch to an endless track generated from a seed, with a finish line every lapLength segments
+    void createStream(unsigned seed, int lapLength);
+
+    // Race progress of a car that went `wraps` times over the arrays and is now on `segment`.
+    // The first finish line is at the end of the first pass, as the grid starts just before it.
+    long long distance(int wraps, int segment) const { return static_cast<long long>(wraps) * count + segment; }
+    int lapsDone(int wraps, int segment) const
+    {
+        long long d = distance(wraps, segment);
+        return d < count ? 0 : static_cast<int>((d - count) / lapSegments) + 1;
+    }
+    // Distance at which a car has completed `laps` laps
+    long long finishDistance(int laps) const { return count + static_cast<long long>(laps - 1) * lapSegments; }
+
+    // Curve under a car; on a streamed track cars outside the ring get it from the generator
+    float curveAt(int wraps, int segment) const { return stream ? streamedCurve(distance(wraps, segment)) : curve[segment]; }
+    // Move the streamed window to the camera (no-op on a looping track). Only the simulation calls it.
+    void follow(int wraps, int segment) const;
+
+    // Road centre at a fractional segment position, in constant time.
+    // Positions past the end (or before the start) continue into the next (previous) lap.
+    TrackPoint pointAt(double segment) const;
+    // Same, with x seen from a camera on segment `from` looking along the road
+    TrackPoint pointFrom(double from, double segment) const;
+
+private:
+    int count = 0;
+    int lapSegments = 0; // count, unless streamed
+    // Fills the arrays of a streamed track. Declared before the storage it writes into,
+    // so a move assignment stops the old generator before releasing its arrays.
+    std::unique_ptr<TrackStream> stream;
+    // Prefix sums over one lap, count + 1 entries:
+    // heading[i] = curve[0] + ... + curve[i - 1], offset[i] = heading[0] + ... + heading[i - 1]
+    std::vector<double> heading, offset;
+    std::vector<unsigned char> storage; // Built in memory
+    MappedFile mapping; // Loaded from a file
+
+    float streamedCurve(long long g) const;
+
+    void bind(const unsigned char* image, int n);
+    void locate(double segment, int& i, double& t, double& lap, double& x, double& slope) const;
+};
+
+// Built-in track used by the game; more segments extend the last curve and the hills
+Track buildDefaultTrack(int segments = N_LINES);
@@ -0,0 +1,156 @@
+#include "TrackStream.h"
+#include "Log.h"
+#include "Profiler.h"
+
+#include <cmath>
+#include <cstdint>
+
+static const float pi = 3.14159265f;
+
+static long long floorDiv(long long a, long long b)
+{
+    long long q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+// splitmix64 finaliser: a well spread hash of the seed and a key
+static std::uint64_t mix(std::uint64_t seed, long long key)
+{
+    std::uint64_t z = seed * 0x9E3779B97F4A7C15ull + static_cast<std::uint64_t>(key);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static float unit(std::uint64_t h) // [0, 1]
+{
+    return static_cast<float>(h & 0xFFFF) / 65535.0f;
+}
+
+float TrackGenerator::curve(long long g) const
+{
+    // Grade de largada e a primeira reta sem curvas
+    if (g < lapStart + STREAM_CHUNK) return 0.0f;
+    long long chunk = floorDiv(g, STREAM_CHUNK);
+    std::uint64_t h = mix(seed, chunk);
+    if ((h & 3) == 0) return 0.0f; // A quarter of the chunks are straights
+    float amount = 0.2f + 0.6f * unit(h >> 8);
+    if (h & 4) amount = -amount;
+    float t = (static_cast<float>(g - chunk * STREAM_CHUNK) + 0.5f) / STREAM_CHUNK;
+    return amount * std::sin(pi * t);
+}
+
+void TrackGenerator::segment(long long g, float& y, float& curveOut, float& spriteX, unsigned char& sprite, unsigned char& finishLine) const
+{
+    curveOut = curve(g);
+
+    // Hills rise and fall back to zero inside their chunk
+    y = 0.0f;
+    if (g >= lapStart + STREAM_CHUNK) {
+        long long chunk = floorDiv(g, STREAM_CHUNK);
+        std::uint64_t h = mix(seed ^ 0x51ED270Bu, chunk);
+        if (h % 3 != 0) {
+            float height = 300.0f + 1200.0f * unit(h >> 8);
+            if (h & 4) height = -height;
+            float t = static_cast<float>(g - chunk * STREAM_CHUNK) / STREAM_CHUNK;
+            y = height * 0.5f * (1.0f - std::cos(2.0f * pi * t));
+        }
+    }
+
+    // Mesmo cenário da pista embutida, sorteado por segmento
+    sprite = SPRITE_NONE;
+    spriteX = 0.0f;
+    long long index = g - lapStart;
+    if (g % 17 == 0) { spriteX = 2.0f; sprite = 6; }
+    if (g % 20 == 0) {
+        switch (mix(seed + 1, g) % 3) {
+        case 0: spriteX = -2.5f; sprite = 5; break;
+        case 1: spriteX = -0.7f; sprite = 4; break;
+        default: spriteX = -1.2f; sprite = 1; break;
+        }
+    }
+    if (index >= 0 && index % 500 == 250) { spriteX = -1.2f; sprite = SPRITE_GAS; }
+
+    finishLine = index >= 0 && index % lapLength < 10;
+}
+
+TrackStream::TrackStream(const TrackGenerator& gen, TrackArrays arrays, double* headingTable, double* offsetTable, int count)
+    : generator(gen), ring(arrays), heading(headingTable), offset(offsetTable), segments(count)
+{
+    worker = std::thread(&TrackStream::run, this);
+}
+
+TrackStream::~TrackStream()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+void TrackStream::generate(long long chunk)
+{
+    long long start = profileNowNs();
+    const long long first = chunk * STREAM_CHUNK;
+    const int base = static_cast<int>(first - floorDiv(first, segments) * segments);
+    for (int k = 0; k < STREAM_CHUNK; k++) {
+        int i = base + k;
+        generator.segment(first + k, ring.y[i], ring.curve[i], ring.spriteX[i], ring.sprite[i], ring.isFinishLine[i]);
+        heading[i] = nextHeading;
+        offset[i] = nextOffset;
+        nextOffset += nextHeading;
+        nextHeading += ring.curve[i];
+    }
+    generated.fetch_add(1, std::memory_order_relaxed);
+    generatedNs.fetch_add(profileNowNs() - start, std::memory_order_relaxed);
+}
+
+void TrackStream::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        // Gera à frente até encher o anel; o pedaço sobrescrito já ficou para trás
+        wake.wait(lock, [&]() { return quit || head.load(std::memory_order_relaxed) < tail + STREAM_CHUNKS; });
+        if (quit) break;
+        long long chunk = head.load(std::memory_order_relaxed);
+        generate(chunk);
+        head.store(chunk + 1, std::memory_order_release);
+    }
+}
+
+void TrackStream::follow(long long g)
+{
+    const long long wantTail = floorDiv(g - STREAM_BEHIND, STREAM_CHUNK);
+    const long long needHead = floorDiv(g + STREAM_AHEAD, STREAM_CHUNK) + 1;
+    if (wantTail == tail && needHead <= head.load(std::memory_order_acquire)) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        long long chunk = head.load(std::memory_order_relaxed);
+        if (wantTail < tail || wantTail > chunk) {
+            // Fora do anel: recomeça a partir daqui. Os valores dependem só da semente,
+            // e as tabelas de deslocamento só são usadas em diferenças dentro da janela.
+            rewindCount++;
+            LOG_DEBUG(LogCategory::Race, "Track stream restarted at segment %lld", g);
+            chunk = wantTail;
+            nextHeading = nextOffset = 0.0;
+        }
+        else if (needHead > chunk) {
+            stallCount++;
+            LOG_INFO_EVERY(1.0, LogCategory::Race, "Track generation fell behind at segment %lld", g);
+        }
+        tail = wantTail;
+        for (; chunk < needHead; chunk++) generate(chunk);
+        head.store(chunk, std::memory_order_release);
+    }
+    wake.notify_one();
+}
+
+float TrackStream::curveAt(long long g) const
+{
+    long long chunk = floorDiv(g, STREAM_CHUNK);
+    if (chunk >= tail && chunk < head.load(std::memory_order_acquire)) return ring.curve[g - floorDiv(g, segments) * segments];
+    return generator.curve(g);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Track.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Streamed tracks are generated in chunks into a ring of STREAM_CHUNKS chunks,
+// so memory stays the same however long the race is
+const int STREAM_CHUNK = 128; // Segments per chunk
+const int STREAM_CHUNKS = 24; // 3072 segments in the ring, a multiple of 384 so the road banding and its merged runs stay in phase
+const int STREAM_BEHIND = STREAM_CHUNK; // Kept behind the camera for the frame being drawn
+// Must be ready ahead of the camera: the longest draw distance, fuel pickups and some slack.
+// With STREAM_BEHIND and a chunk at either end it still fits in the ring.
+const int STREAM_AHEAD = MAX_DRAW_DISTANCE + 300;
+const int MIN_STREAM_LAP = 300;
+
+// Procedural layout: every value of global segment g depends only on the seed and g.
+// Curves and hills are chosen per chunk and fade in and out inside it, so chunks join smoothly.
+struct TrackGenerator
+{
+    unsigned seed = 0;
+    long long lapStart = 0; // Global segment of the first finish line
+    int lapLength = 0; // Segments per lap
+
+    float curve(long long g) const;
+    void segment(long long g, float& y, float& curve, float& spriteX, unsigned char& sprite, unsigned char& finishLine) const;
+};
+
+// Keeps the ring filled around the camera.
+// A background thread generates chunks ahead until the ring is full; follow() moves the window
+// and only generates on the calling thread if the background thread fell behind (counted as a stall)
+// or the camera moved back out of the ring (a rewind, e.g. when the race restarts).
+// Chunks behind the window are reused, so readers must stay inside it; the frame being drawn lags the
+// simulation by one frame, which STREAM_BEHIND covers. A rewind rewrites the whole ring, so the drawing
+// thread reads nothing from it: the frame snapshot carries the finish-line flags it needs.
+struct TrackStream
+{
+    TrackStream(const TrackGenerator& generator, TrackArrays arrays, double* heading, double* offset, int segments);
+    TrackStream(const TrackStream&) = delete;
+    TrackStream& operator=(const TrackStream&) = delete;
+    ~TrackStream();
+
+    const TrackGenerator generator;
+
+    // Called by the simulation thread with the camera's global segment
+    void follow(long long g);
+    // Curve anywhere on the track: from the ring when g is in it, generated otherwise.
+    // Only for the thread that calls follow().
+    float curveAt(long long g) const;
+
+    // Statistics
+    long long chunksGenerated() const { return generated.load(std::memory_order_relaxed); }
+    long long generateNs() const { return generatedNs.load(std::memory_order_relaxed); }
+    int stalls() const { return stallCount; }
+    int rewinds() const { return rewindCount; }
+
+private:
+    TrackArrays ring;
+    double* heading;
+    double* offset;
+    const int segments; // STREAM_CHUNKS * STREAM_CHUNK
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread worker;
+    bool quit = false;
+    long long tail = 0; // First chunk in the window; written by follow() under the mutex
+    std::atomic<long long> head{ 0 }; // One past the last generated chunk
+    double nextHeading = 0.0, nextOffset = 0.0; // Prefix tables at the start of chunk head
+    std::atomic<long long> generated{ 0 }, generatedNs{ 0 };
+    int stallCount = 0, rewindCount = 0;
+
+    void generate(long long chunk); // Mutex held
+    void run();
+};
@@ -0,0 +1,100 @@
+#include "Traffic.h"
+
+#include <algorithm>
+#include <cmath>
+
+void Traffic::reset(int carCount, double length, bool isLooping, double offset)
+{
+    x.assign(carCount, 0.0f);
+    speed.assign(carCount, 0.0f);
+    racing.assign(carCount, 0);
+    lapLength = length;
+    looping = isLooping;
+    playerOffset = offset;
+    near.clear();
+    near.reserve(carCount);
+    tested = 0;
+}
+
+void Traffic::lapRange(const RaceStandings& standings, double from, double to, int& firstLap, int& lastLap) const
+{
+    // Voltas de diferença que podem ter algum carro na janela; numa pista gerada a estrada não se repete
+    firstLap = lastLap = 0;
+    if (!looping) return;
+    const int n = standings.carCount();
+    double lead = std::max(standings.distanceOf(standings.carAt(1)), distanceOf(standings, 0));
+    double last = standings.distanceOf(standings.carAt(n));
+    firstLap = static_cast<int>(std::ceil((last - to) / lapLength));
+    lastLap = static_cast<int>(std::floor((lead - from) / lapLength));
+}
+
+void Traffic::carsBetween(const RaceStandings& standings, double from, double to, int self, std::vector<int>& out) const
+{
+    const int n = standings.carCount();
+    if (n == 0) return;
+
+    int firstLap, lastLap;
+    lapRange(standings, from, to, firstLap, lastLap);
+
+    for (int lap = firstLap; lap <= lastLap; lap++) {
+        double lo = from + lap * lapLength, hi = to + lap * lapLength;
+        // Cars beyond hi come first in the order; walk down from the first one at or behind it
+        for (int r = standings.countAhead(hi) + 1; r <= n; r++) {
+            int car = standings.carAt(r);
+            if (standings.distanceOf(car) <= lo) break;
+            if (car != 0 && car != self && racing[car]) out.push_back(car);
+        }
+        // The player's car is not where its rank puts it
+        double player = distanceOf(standings, 0);
+        if (self != 0 && racing[0] && player > lo && player <= hi) out.push_back(0);
+    }
+}
+
+void Traffic::carsAhead(const RaceStandings& standings, double from, double to, int self, int maxCars, std::vector<int>& out) const
+{
+    const int n = standings.carCount();
+    if (n == 0) return;
+
+    int firstLap, lastLap;
+    lapRange(standings, from, to, firstLap, lastLap);
+
+    for (int lap = firstLap; lap <= lastLap; lap++) {
+        double lo = from + lap * lapLength, hi = to + lap * lapLength;
+        // The car just ahead of lo is the last of the cars farther than it; walk up from there.
+        // From a car's own distance it is just above its rank, past the cars level with it
+        int first;
+        if (lap == 0 && self != 0 && from == standings.distanceOf(self)) {
+            first = standings.rankOf(self) - 1;
+            while (first >= 1 && standings.distanceOf(standings.carAt(first)) <= lo) first--;
+        }
+        else first = standings.countAhead(lo);
+        for (int r = first; r >= 1 && r > first - maxCars; r--) {
+            int car = standings.carAt(r);
+            if (standings.distanceOf(car) > hi) break;
+            if (car != 0 && car != self && racing[car]) out.push_back(car);
+        }
+        double player = distanceOf(standings, 0);
+        if (self != 0 && racing[0] && player > lo && player <= hi) out.push_back(0);
+    }
+}
+
+void Traffic::findContacts(const RaceStandings& standings, std::vector<CarContact>& out)
+{
+    tested = 0;
+    const int n = standings.carCount();
+    for (int r = 1; r <= n; r++) {
+        int ahead = standings.carAt(r);
+        if (!racing[ahead]) continue;
+
+        // Each pair once: from the car ahead, looking back one car length
+        double d = distanceOf(standings, ahead);
+        near.clear();
+        carsBetween(standings, d - carLength, d, ahead, near);
+        for (int behind : near) {
+            // Side by side at the same distance: only from the higher index, like the standings order
+            if (behind > ahead && std::fmod(d - distanceOf(standings, behind), lapLength) == 0.0) continue;
+            tested++;
+            if (std::abs(x[ahead] - x[behind]) < 2.0f * carHalfWidth) out.push_back({ behind, ahead });
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "GameConstants.h"
+#include "Standings.h"
+
+#include <vector>
+
+const float carHalfWidth = 0.3f; // In road half-widths
+const float carLength = 1.5f * segL; // Along the track, from the rear where a car stands on the road
+
+// Two racing cars touching, by standings index (0 = player)
+struct CarContact
+{
+    int behind, ahead;
+};
+
+// Cars on the road, found through the race order of RaceStandings. The order is sorted by race
+// distance, so the cars near a point of the road are a run of the order found by binary search and
+// a short walk, and a tick costs about one lookup per car instead of a test of every pair.
+// On a looping track cars whole laps apart share the road as well: one more lookup per lap of
+// difference between the leader and the last car.
+// The player is ranked by the camera but its car drives playerOffset ahead of it, so car 0 is
+// checked on its own rather than found in the walk.
+struct Traffic
+{
+    // Per car, by standings index, as of the last tick
+    std::vector<float> x; // Lateral position
+    std::vector<float> speed;
+    std::vector<unsigned char> racing; // 0 before the start and for finished cars, which are off the road
+
+    void reset(int carCount, double lapLength, bool looping, double playerOffset);
+
+    // Race distance of the rear of a car
+    double distanceOf(const RaceStandings& standings, int car) const
+    {
+        return standings.distanceOf(car) + (car == 0 ? playerOffset : 0.0);
+    }
+
+    // Append the racing cars other than `self` whose rear is in (from, to] of race distance,
+    // or whole laps from it on a looping track
+    void carsBetween(const RaceStandings& standings, double from, double to, int self, std::vector<int>& out) const;
+
+    // Same window, but only among the maxCars next in the order after `from` per lap, walking up from there,
+    // finished cars included: the cost stays the same however many cars crowd the window.
+    // The player's car, not where its rank puts it, comes on top.
+    void carsAhead(const RaceStandings& standings, double from, double to, int self, int maxCars, std::vector<int>& out) const;
+
+    // Append every pair of racing cars less than carLength apart along the track and
+    // 2 * carHalfWidth across it. The standings must be up to date.
+    void findContacts(const RaceStandings& standings, std::vector<CarContact>& out);
+
+    // Pairs tested by the last findContacts, for comparing with the n * (n - 1) / 2 of testing them all
+    long long pairsTested() const { return tested; }
+
+private:
+    double lapLength = 0.0;
+    bool looping = true;
+    double playerOffset = 0.0;
+    std::vector<int> near; // Scratch for findContacts
+    long long tested = 0;
+
+    // Laps of difference that can have a car in (from, to]
+    void lapRange(const RaceStandings& standings, double from, double to, int& firstLap, int& lastLap) const;
+};
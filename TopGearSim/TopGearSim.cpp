@@ -0,0 +1,474 @@
+// topgear-sim: runs complete races headless, with no window, and reports races per second
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FixedTimestep.h"
+#include "GameConstants.h"
+#include "Log.h"
+#include "Projection.h"
+#include "Replay.h"
+#include "Simulation.h"
+#include "Track.h"
+#include "TrackStream.h"
+
+// Hold W and shift up as soon as the gear allows it
+unsigned char pedals(const Simulation& sim)
+{
+    unsigned char held = InputSnapshot::bit(Control::Accelerate);
+    if (sim.player.speed >= gearMaxSpeed[sim.player.gear] * 0.8f) held |= InputSnapshot::bit(Control::ShiftUp);
+    return held;
+}
+
+// Lateral position that just touches the next fuel station in sight, if there is one
+bool nextStationX(const Simulation& sim, float& x)
+{
+    const Player& p = sim.player;
+    const int n = sim.track.size();
+    for (int k = 1; k <= 300; k++) {
+        Collidable c;
+        int slot = (p.pos / segL + carReach + k) % n;
+        if (CollisionIndex::fromSprite(sim.track, slot, c) && c.kind == CollidableKind::Pickup) {
+            x = c.right + carHalfWidth * 0.6f;
+            return true;
+        }
+    }
+    return false;
+}
+
+unsigned char steerTo(const Player& p, float targetX)
+{
+    if (p.x < targetX - 0.05f) return InputSnapshot::bit(Control::Right);
+    if (p.x > targetX + 0.05f) return InputSnapshot::bit(Control::Left);
+    return 0;
+}
+
+// Pedals only, letting the curves push the car, except to pull over for the fuel stations
+unsigned char scriptedInput(const Simulation& sim)
+{
+    float stationX;
+    return pedals(sim) | (nextStationX(sim, stationX) ? steerTo(sim.player, stationX) : 0);
+}
+
+// Pedals plus steering back to the middle of the road against the curve, and to fuel stations
+unsigned char aiInput(const Simulation& sim)
+{
+    float targetX = -sim.track.pointAt(sim.player.pos / segL).curve * 0.3f;
+    nextStationX(sim, targetX);
+    return pedals(sim) | steerTo(sim.player, targetX);
+}
+
+// FNV-1a over the bits of the final race state, to compare runs exactly
+void hashBytes(uint64_t& h, const void* data, size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+        h ^= bytes[i];
+        h *= 1099511628211ULL;
+    }
+}
+
+void hashRace(uint64_t& h, const Simulation& sim)
+{
+    hashBytes(h, &sim.player.pos, sizeof(sim.player.pos));
+    hashBytes(h, &sim.player.posFraction, sizeof(sim.player.posFraction));
+    hashBytes(h, &sim.player.x, sizeof(sim.player.x));
+    hashBytes(h, &sim.player.speed, sizeof(sim.player.speed));
+    hashBytes(h, &sim.player.gas, sizeof(sim.player.gas));
+    hashBytes(h, &sim.raceTime, sizeof(sim.raceTime));
+    const OpponentField& o = sim.opponents;
+    for (int i = 0; i < o.size(); i++) {
+        hashBytes(h, &o.pos[i], sizeof(o.pos[i]));
+        hashBytes(h, &o.x[i], sizeof(o.x[i]));
+        hashBytes(h, &o.laps[i], sizeof(o.laps[i]));
+    }
+}
+
+// Project the draw window from every segment of the ring with the per-segment projectSegment,
+// the way the game loop used to, for comparing the batch kernels against
+void projectWindowReference(const Track& track, ProjectedTrack& proj, int startPos, int count, float camX, float camY)
+{
+    const int n = track.size();
+    for (int k = 0; k < count; k++) {
+        int i = (startPos + k) % n;
+        float camZ = static_cast<float>(startPos * segL - (startPos + k >= n ? n * segL : 0));
+        projectSegment(track, proj, i, camX - proj.roadX[i], camY, camZ);
+    }
+}
+
+bool sameProjection(float a, float b)
+{
+    if (!std::isfinite(a) || !std::isfinite(b)) return std::isnan(a) == std::isnan(b) && (std::isnan(a) || a == b);
+    return std::fabs(a - b) <= 1e-4f * std::max(1.0f, std::fabs(b));
+}
+
+// Check every kernel against projectSegment over the full ring, then time them
+int benchProjection(const Track& track)
+{
+    const int n = track.size();
+    const int window = 300;
+    const float camX = 300.0f, camY = 1500.0f;
+    ProjectedTrack reference, proj;
+    reference.resize(n);
+    proj.resize(n);
+
+    const ProjectionKernel kernels[] = { ProjectionKernel::Scalar, ProjectionKernel::SSE, ProjectionKernel::AVX2, ProjectionKernel::NEON };
+    const int repeats = std::max(1, 2000000 / n);
+    const double segments = static_cast<double>(repeats) * n * window;
+    bool allMatch = true;
+
+    // Road offsets of every window, so the timings cover only the projection
+    std::vector<std::vector<float>> roadX(n, std::vector<float>(window));
+    for (int s = 0; s < n; s++) {
+        for (int k = 0; k < window; k++) roadX[s][k] = track.pointFrom(s, s + k).x;
+    }
+    auto setRoadX = [&](ProjectedTrack& p, int s) {
+        for (int k = 0; k < window; k++) p.roadX[(s + k) % n] = roadX[s][k];
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++) {
+        for (int s = 0; s < n; s++) projectWindowReference(track, reference, s, window, camX, camY);
+    }
+    double referenceSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "projectSegment: " << referenceSeconds * 1e9 / segments << " ns/segment" << std::endl;
+
+    for (ProjectionKernel kernel : kernels) {
+        if (!setProjectionKernel(kernel)) continue;
+
+        int mismatches = 0;
+        for (int s = 0; s < n; s++) {
+            setRoadX(reference, s);
+            setRoadX(proj, s);
+            projectWindowReference(track, reference, s, window, camX, camY);
+            projectWindow(track, proj, s, window, camX, camY);
+            for (int k = 0; k < window; k++) {
+                int i = (s + k) % n;
+                if (!sameProjection(proj.X[i], reference.X[i]) || !sameProjection(proj.Y[i], reference.Y[i]) ||
+                    !sameProjection(proj.W[i], reference.W[i]) || !sameProjection(proj.scale[i], reference.scale[i])) {
+                    mismatches++;
+                }
+            }
+        }
+        allMatch = allMatch && mismatches == 0;
+
+        // Time the batch part of projectWindow alone, split at the end of the ring like it does
+        start = std::chrono::steady_clock::now();
+        for (int r = 0; r < repeats; r++) {
+            for (int s = 0; s < n; s++) {
+                int firstSpan = std::min(window, n - s);
+                ProjectionCamera camera = { camX, camY, static_cast<float>(s * segL) };
+                projectSegments(track, proj, s, firstSpan, camera);
+                if (window > firstSpan) {
+                    camera.z -= static_cast<float>(n * segL);
+                    projectSegments(track, proj, 0, window - firstSpan, camera);
+                }
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << projectionKernelName(kernel) << ": " << seconds * 1e9 / segments << " ns/segment, "
+            << referenceSeconds / seconds << "x, " << (mismatches == 0 ? "matches" : "MISMATCH") << " over "
+            << n << " start segments (" << mismatches << " values off)" << std::endl;
+    }
+    setProjectionKernel(ProjectionKernel::Auto);
+    std::cout << "Auto kernel: " << projectionKernelName(projectionKernel()) << std::endl;
+    return allMatch ? 0 : 1;
+}
+
+// Time the opponent update, the standings and a whole simulation step, per tick for growing fields
+void benchOpponents(const Track& track, float simRate)
+{
+    const int counts[] = { 2, 10, 100, 200, 500, 1000, 2000 };
+    const int ticks = 20000;
+    const float dt = 1.0f / simRate;
+    InputSnapshot input = InputSnapshot::fromHeld(InputSnapshot::bit(Control::Accelerate), InputSnapshot::bit(Control::Accelerate));
+
+    for (int count : counts) {
+        Simulation sim(track, count);
+        sim.raceStarted = true;
+        auto start = std::chrono::steady_clock::now();
+        for (int t = 0; t < ticks; t++) sim.opponents.update(dt, track, true, sim.standings, sim.traffic);
+        double updateSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        // Standings alone, with the cars moving between calls as in a race
+        sim.reset();
+        sim.raceStarted = true;
+        double rankingSeconds = 0.0;
+        for (int t = 0; t < ticks; t++) {
+            sim.opponents.update(dt, track, true, sim.standings, sim.traffic);
+            start = std::chrono::steady_clock::now();
+            sim.updateRankings();
+            rankingSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        sim.reset();
+        start = std::chrono::steady_clock::now();
+        for (int t = 0; t < ticks; t++) sim.step(input, dt);
+        double stepSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << count << " opponents: update " << updateSeconds * 1e6 / ticks << " us/tick ("
+            << updateSeconds * 1e9 / ticks / count << " ns/car), standings " << rankingSeconds * 1e9 / ticks / (count + 1)
+            << " ns/car, whole step " << stepSeconds * 1e6 / ticks << " us/tick" << std::endl;
+    }
+}
+
+// Contacts by testing every pair of cars, for checking findContacts against
+long long countContactsAllPairs(const Simulation& sim)
+{
+    const Traffic& traffic = sim.traffic;
+    const double trackLength = static_cast<double>(sim.track.size()) * segL;
+    const int n = sim.standings.carCount();
+    long long found = 0;
+    for (int a = 0; a < n; a++) {
+        if (!traffic.racing[a]) continue;
+        double da = traffic.distanceOf(sim.standings, a);
+        for (int b = a + 1; b < n; b++) {
+            if (!traffic.racing[b]) continue;
+            double gap = da - traffic.distanceOf(sim.standings, b);
+            if (!sim.track.isStreamed()) gap -= std::round(gap / trackLength) * trackLength;
+            if (std::abs(gap) < carLength && std::abs(traffic.x[a] - traffic.x[b]) < 2.0f * carHalfWidth) found++;
+        }
+    }
+    return found;
+}
+
+// Pull every second opponent half a car length behind the one before it, in its lane, so the field is
+// made of overlapping pairs; the standings and the traffic take the new places as the next step would
+void packPairs(Simulation& sim)
+{
+    OpponentField& o = sim.opponents;
+    for (int i = 1; i < o.size(); i += 2) {
+        if (!sim.traffic.racing[i] || !sim.traffic.racing[i + 1]) continue;
+        o.laps[i] = o.laps[i - 1];
+        o.pos[i] = o.pos[i - 1] >= carLength * 0.5f ? o.pos[i - 1] - carLength * 0.5f : o.pos[i - 1] + carLength * 0.5f;
+        o.x[i] = o.x[i - 1];
+        sim.traffic.x[i + 1] = o.x[i];
+    }
+    sim.updateRankings();
+}
+
+// Time the contact search against testing every pair, and a whole simulation step, per tick for growing fields.
+// The grid spaces the cars 2 segments apart, closer on a track too short for them; there they would start
+// overlapping and pile up, so larger fields race on a built-in track long enough for the whole grid.
+// Cars that race apart never touch, so for the first half of the run the field is packed into
+// overlapping pairs after each step, and both searches must find them.
+bool benchTraffic(const Track& track, float simRate)
+{
+    const int counts[] = { 10, 100, 1000 };
+    const int ticks = 4000;
+    const float dt = 1.0f / simRate;
+    InputSnapshot input = InputSnapshot::fromHeld(InputSnapshot::bit(Control::Accelerate), InputSnapshot::bit(Control::Accelerate));
+    bool allMatch = true;
+
+    for (int count : counts) {
+        const int gridSegments = 4 * count; // Half a lap at 2 segments per car, see Simulation::reset
+        Track longer;
+        const bool lengthen = track.size() < gridSegments;
+        if (lengthen) longer = buildDefaultTrack(gridSegments);
+        Simulation sim(lengthen ? longer : track, count);
+        std::vector<CarContact> contacts;
+        double stepSeconds = 0.0, findSeconds = 0.0, allPairsSeconds = 0.0;
+        long long found = 0, foundAllPairs = 0, tested = 0;
+        for (int t = 0; t < ticks; t++) {
+            auto start = std::chrono::steady_clock::now();
+            sim.step(input, dt);
+            auto stepped = std::chrono::steady_clock::now();
+            stepSeconds += std::chrono::duration<double>(stepped - start).count();
+            if (t < ticks / 2) packPairs(sim);
+
+            // The cars left touching after this tick's response, or packed together
+            contacts.clear();
+            start = std::chrono::steady_clock::now();
+            sim.traffic.findContacts(sim.standings, contacts);
+            auto searched = std::chrono::steady_clock::now();
+            foundAllPairs += countContactsAllPairs(sim);
+            allPairsSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - searched).count();
+            findSeconds += std::chrono::duration<double>(searched - start).count();
+            found += static_cast<long long>(contacts.size());
+            tested += sim.traffic.pairsTested();
+        }
+        if (found != foundAllPairs) allMatch = false;
+
+        std::cout << count << " opponents: contacts " << findSeconds * 1e6 / ticks << " us/tick ("
+            << static_cast<double>(tested) / ticks << " pairs tested, " << found << " contacts found), all pairs "
+            << allPairsSeconds * 1e6 / ticks << " us/tick (" << static_cast<double>(count + 1) * count / 2 << " pairs, "
+            << foundAllPairs << " contacts found)" << (found == foundAllPairs ? "" : " (MISMATCH)")
+            << ", whole step " << stepSeconds * 1e6 / ticks << " us/tick"
+            << (lengthen ? " on the built-in track of " + std::to_string(gridSegments) + " segments" : std::string()) << std::endl;
+    }
+    return allMatch;
+}
+
+void printUsage()
+{
+    std::cout << "Usage: topgear-sim [--races N] [--input ai|script] [--rate HZ] [--fps N [--realtime]] [--verbose] [--log SPEC] [--record FILE]\n"
+        << "                   [--track FILE] [--write-track FILE [--segments N]] [--bench-projection]\n"
+        << "                   [--opponents N] [--bench-opponents] [--bench-traffic] [--stream SEED [--lap N]]" << std::endl
+        << "                   [--gas-rate GAS_PER_S] [--obstacle-speed FACTOR]" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    int races = 100;
+    bool useAi = true;
+    float simRate = SIM_RATE;
+    float fps = 0.0f; // 0 = step the simulation directly, otherwise feed frames of 1/fps seconds
+    bool realTime = false; // Feed the frames at the wall-clock rate of the game, not as fast as possible
+    bool verbose = false;
+    std::string recordFile; // Inputs of the first race, for replaying in the game
+    std::string trackFile, writeTrackFile;
+    int segments = N_LINES;
+    bool projectionBench = false;
+    bool opponentBench = false;
+    bool trafficBench = false;
+    int opponentCount = 2;
+    bool streamed = false;
+    unsigned streamSeed = 0;
+    int lapLength = 4000;
+    float gasPickupRate = -1.0f, obstacleSpeedFactor = -1.0f; // Simulation defaults unless given
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--races" && i + 1 < argc) races = std::atoi(argv[++i]);
+        else if (arg == "--input" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "ai") useAi = true;
+            else if (mode == "script") useAi = false;
+            else { printUsage(); return -1; }
+        }
+        else if (arg == "--rate" && i + 1 < argc) simRate = static_cast<float>(std::atof(argv[++i]));
+        else if (arg == "--fps" && i + 1 < argc) fps = static_cast<float>(std::atof(argv[++i]));
+        else if (arg == "--realtime") realTime = true;
+        else if (arg == "--verbose") verbose = true;
+        else if (arg == "--record" && i + 1 < argc) recordFile = argv[++i];
+        else if (arg == "--track" && i + 1 < argc) trackFile = argv[++i];
+        else if (arg == "--write-track" && i + 1 < argc) writeTrackFile = argv[++i];
+        else if (arg == "--segments" && i + 1 < argc) segments = std::atoi(argv[++i]);
+        else if (arg == "--bench-projection") projectionBench = true;
+        else if (arg == "--bench-opponents") opponentBench = true;
+        else if (arg == "--bench-traffic") trafficBench = true;
+        else if (arg == "--opponents" && i + 1 < argc) opponentCount = std::atoi(argv[++i]);
+        else if (arg == "--stream" && i + 1 < argc) {
+            streamed = true;
+            streamSeed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--lap" && i + 1 < argc) lapLength = std::atoi(argv[++i]);
+        else if (arg == "--gas-rate" && i + 1 < argc) gasPickupRate = static_cast<float>(std::atof(argv[++i]));
+        else if (arg == "--obstacle-speed" && i + 1 < argc) obstacleSpeedFactor = static_cast<float>(std::atof(argv[++i]));
+        else if (arg == "--log" && i + 1 < argc) {
+            if (!logConfigure(argv[++i])) { printUsage(); return -1; }
+            verbose = true;
+        }
+        else { printUsage(); return -1; }
+    }
+    if (races <= 0 || simRate <= 0.0f || fps < 0.0f || (realTime && fps <= 0.0f) || segments < MIN_TRACK_SEGMENTS || opponentCount < 0 || lapLength < MIN_STREAM_LAP) {
+        printUsage();
+        return -1;
+    }
+
+    LogSession logSession;
+    if (!verbose) logSetLevel(LogLevel::Warn);
+
+    // Converter: write the built-in track as a binary track file and stop
+    if (!writeTrackFile.empty()) {
+        Track builtIn = buildDefaultTrack(segments);
+        if (!builtIn.saveToFile(writeTrackFile)) return -1;
+        std::cout << "Wrote " << writeTrackFile << " (" << segments << " segments)" << std::endl;
+        return 0;
+    }
+
+    Track track;
+    if (!trackFile.empty()) {
+        auto loadStart = std::chrono::steady_clock::now();
+        if (!track.loadFromFile(trackFile)) return -1;
+        double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+        std::cout << "Loaded " << trackFile << ": " << track.size() << " segments in " << loadMs << " ms" << std::endl;
+    }
+    else if (streamed) track.createStream(streamSeed, lapLength);
+    else track = buildDefaultTrack();
+    if (projectionBench) return benchProjection(track);
+    if (opponentBench) {
+        benchOpponents(track, simRate);
+        return 0;
+    }
+    if (trafficBench) return benchTraffic(track, simRate) ? 0 : 1;
+
+    Simulation sim(track, opponentCount);
+    if (gasPickupRate >= 0.0f) sim.gasPickupRate = gasPickupRate;
+    if (obstacleSpeedFactor >= 0.0f) sim.obstacleSpeedFactor = obstacleSpeedFactor;
+
+    // Stop a race that does not end, e.g. a car stuck on the grass with no gas
+    const float maxRaceTime = 3600.0f;
+
+    InputRecording recording;
+    recording.simRate = simRate;
+
+    uint64_t checksum = 14695981039346656037ULL;
+    long long totalTicks = 0;
+    double totalRaceTime = 0.0;
+    int positionSum = 0;
+    int unfinished = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < races; r++) {
+        sim.reset();
+        FixedTimestep timestep(simRate);
+        float simTime = 0.0f;
+        unsigned char held = 0; // Controls held at the previous tick
+        auto frameDue = std::chrono::steady_clock::now();
+        while (!sim.isRaceOver() && simTime < maxRaceTime) {
+            if (realTime) {
+                frameDue += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / fps));
+                std::this_thread::sleep_until(frameDue);
+            }
+            // Without --fps every loop is one tick; with it, a frame runs however many ticks fit
+            int ticks = fps > 0.0f ? timestep.advance(1.0f / fps) : 1;
+            for (int t = 0; t < ticks && !sim.isRaceOver(); t++) {
+                InputSnapshot input = InputSnapshot::fromHeld(useAi ? aiInput(sim) : scriptedInput(sim), held);
+                held = input.held;
+                if (r == 0 && !recordFile.empty()) recording.add(input);
+                sim.step(input, timestep.tickSeconds);
+                simTime += timestep.tickSeconds;
+                totalTicks++;
+            }
+        }
+        hashRace(checksum, sim);
+        if (!sim.isRaceOver()) unfinished++;
+        totalRaceTime += sim.raceTime;
+        positionSum += sim.playerPosition;
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    recording.setup = sim.setup();
+    if (!recordFile.empty() && !recording.saveToFile(recordFile)) return -1;
+    double seconds = std::chrono::duration<double>(end - start).count();
+
+    std::cout << "Races: " << races << " (" << TOTAL_LAPS << " laps, " << (useAi ? "ai" : "script") << " input, " << simRate << " Hz, " << opponentCount << " opponents)" << std::endl;
+    std::cout << "Average race time: " << totalRaceTime / races << " s, average position: "
+        << static_cast<double>(positionSum) / races << ", unfinished: " << unfinished << std::endl;
+    std::cout << "Ticks: " << totalTicks << ", wall time: " << seconds << " s" << std::endl;
+    std::cout << "Checksum: " << std::hex << checksum << std::dec << std::endl;
+    std::cout << "Races per second: " << races / seconds << std::endl;
+    if (const TrackStream* stream = track.streamer()) {
+        // At top speed a chunk lasts this long; generating one must take far less
+        double chunkSeconds = STREAM_CHUNK * segL / (gearMaxSpeed[maxGear] * 125.0);
+        long long chunks = stream->chunksGenerated();
+        std::cout << "Track stream: seed " << streamSeed << ", " << lapLength << " segments per lap, "
+            << chunks << " chunks generated, " << (chunks > 0 ? stream->generateNs() / 1e3 / chunks : 0.0) << " us per chunk ("
+            << chunkSeconds * 1e3 << " ms of driving at top speed), " << stream->stalls() << " stalls, "
+            << stream->rewinds() << " rewinds" << std::endl;
+        // Paced like the game, the generator thread must always be ahead of the camera
+        if (realTime && stream->stalls() > 0) {
+            std::cout << "Track generation stalled in real time." << std::endl;
+            return 1;
+        }
+    }
+
+    return unfinished == 0 ? 0 : 1;
+}